@@ -0,0 +1,69 @@
+/**
+ * @file allocations.cpp
+ * @brief Counts heap allocations made by steady-state PushEvent calls.
+ *
+ * Replaces the global allocation functions with counting versions, warms the
+ * registry up, then pushes events and fails if any push allocated.
+ */
+
+#include "../eventlistener.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::size_t> g_allocations{0};
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+static int g_sink = 0;
+
+template <typename F>
+static bool Measure(const char *label, int iterations, F push)
+{
+    push(); // warm-up
+    std::size_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        push();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t allocations = g_allocations.load() - before;
+    std::printf("%-40s %8.1f ns/push %10zu allocations\n", label,
+        std::chrono::duration<double, std::nano>(elapsed).count() / iterations, allocations);
+    return allocations == 0;
+}
+
+int main()
+{
+    const int iterations = 1000000;
+    int object = 0;
+    // Longer than any std::string small-buffer, so a per-call std::string would allocate.
+    const char *name = "AllocationBenchmarkEventWithALongName";
+
+    for (int i = 0; i < 8; ++i)
+        CreateEventListener(&object, name, new EventFunction<int, const char *>([](SEvent event, int a, const char *) {
+            g_sink += a + (int)event.name.size();
+        }));
+    EventId eventId = LookupEventName(name);
+
+    bool ok = true;
+    ok &= Measure("PushEvent(const char*)", iterations, [&] { PushEvent(name, 1, "payload"); });
+    ok &= Measure("PushEvent(EventId)", iterations, [&] { PushEvent(eventId, 1, "payload"); });
+    ok &= Measure("PushEvent(void*, EventId)", iterations, [&] { PushEvent(static_cast<void *>(&object), eventId, 1, "payload"); });
+    ok &= Measure("PushEvent(EventName)", iterations, [&] { PushEvent("AllocationBenchmarkEventWithALongName"_evt, 1, "payload"); });
+    ok &= Measure("PushEvent<\"Name\"_evt>", iterations, [&] { PushEvent<"AllocationBenchmarkEventWithALongName"_evt>(1, "payload"); });
+
+    std::printf("%s\n", ok ? "OK: steady-state dispatch is allocation-free" : "FAIL: dispatch allocated");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file copies.cpp
+ * @brief Counts payload copies made while dispatching one event to a growing number of listeners.
+ *
+ * Listeners taking the payload by const reference should see zero copies no matter how many of them there
+ * are; listeners taking it by value pay exactly one copy each, made for their own parameter. The same holds
+ * for the registry and for typed Event channels.
+ */
+
+#include "../eventlistener.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+struct SPayload
+{
+    static inline int copies = 0;
+    std::vector<char> bytes;
+
+    explicit SPayload(std::size_t size) : bytes(size) {}
+    SPayload(const SPayload &other) : bytes(other.bytes) { ++copies; }
+    SPayload(SPayload &&) = default;
+    SPayload &operator=(const SPayload &other) { bytes = other.bytes; ++copies; return *this; }
+    SPayload &operator=(SPayload &&) = default;
+};
+
+static std::size_t g_sink = 0;
+
+int main()
+{
+    const int pushes = 1000;
+    bool ok = true;
+    std::printf("%10s %16s %16s %14s\n", "listeners", "copies (const&)", "copies (value)", "ns/push (const&)");
+    for (int listeners = 1; listeners <= 64; listeners *= 4)
+    {
+        int byReference = 0, byValue = 0;
+        for (int i = 0; i < listeners; ++i)
+        {
+            CreateEventListener(&byReference, "Packet", [](SEvent, const SPayload &payload) {
+                g_sink += payload.bytes.size();
+            });
+            CreateEventListener(&byValue, "Packet", [](SEvent, SPayload payload) {
+                g_sink += payload.bytes.size();
+            });
+        }
+
+        SPayload payload(64 * 1024);
+        SPayload::copies = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < pushes; ++i)
+            PushEvent(static_cast<void *>(&byReference), "Packet", payload);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        int referenceCopies = SPayload::copies / pushes;
+
+        SPayload::copies = 0;
+        PushEvent(static_cast<void *>(&byValue), "Packet", payload);
+        int valueCopies = SPayload::copies;
+
+        std::printf("%10d %16d %16d %14.1f\n", listeners, referenceCopies, valueCopies,
+            std::chrono::duration<double, std::nano>(elapsed).count() / pushes);
+        ok &= referenceCopies == 0 && valueCopies == listeners;
+
+        DeleteEventListeners(static_cast<void *>(&byReference));
+        DeleteEventListeners(static_cast<void *>(&byValue));
+    }
+
+    // A typed channel hands every listener the same payload, too.
+    for (int listeners = 1; listeners <= 64; listeners *= 4)
+    {
+        Event<SPayload> byReference, byValue;
+        for (int i = 0; i < listeners; ++i)
+        {
+            byReference.Listen([](SEvent, const SPayload &payload) { g_sink += payload.bytes.size(); });
+            byValue.Listen([](SEvent, SPayload payload) { g_sink += payload.bytes.size(); });
+        }
+
+        SPayload payload(64 * 1024);
+        SPayload::copies = 0;
+        byReference(payload);
+        int referenceCopies = SPayload::copies;
+        SPayload::copies = 0;
+        byValue.Push(payload);
+        int valueCopies = SPayload::copies;
+        std::printf("Event<SPayload>, %2d listeners: %d copies (const&), %d copies (value)\n", listeners, referenceCopies, valueCopies);
+        ok &= referenceCopies == 0 && valueCopies == listeners;
+    }
+
+    // An rvalue pushed asynchronously is moved into the queue, never copied.
+    int async = 0;
+    CreateEventListener(&async, "Packet", [](SEvent, const SPayload &payload) {
+        g_sink += payload.bytes.size();
+    });
+    SPayload::copies = 0;
+    PushEventAsync(static_cast<void *>(&async), "Packet", SPayload(64 * 1024));
+    FlushEvents();
+    std::printf("PushEventAsync(rvalue): %d copies\n", SPayload::copies);
+    ok &= SPayload::copies == 0;
+
+    std::printf("%s\n", ok ? "OK: const& listeners never copy the payload" : "FAIL: unexpected payload copies");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+/**
+ * @file suite.cpp
+ * @brief Google Benchmark suite for dispatch, registration and deletion.
+ *
+ * Covers PushEvent latency against listener count, match selectivity, argument size, thread count and listener
+ * call sampling, and the cost of creating and deleting listeners in registries of production-like size. Results
+ * are written as JSON to eventlistener_benchmarks.json unless --benchmark_out is given.
+ */
+
+#include "../eventlistener.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    int g_sink = 0;
+
+    void OnInt(SEvent, int value) { benchmark::DoNotOptimize(g_sink += value); }
+
+    /* Registers `count` listeners on `eventId`, spread over `objects` object addresses. */
+    std::vector<int> AddListeners(EventId eventId, int count, std::vector<int> &objects)
+    {
+        std::vector<int> ids;
+        ids.reserve(count);
+        for (int i = 0; i < count; ++i)
+            ids.push_back(CreateEventListener(&objects[i % objects.size()], eventId, &OnInt));
+        return ids;
+    }
+
+    /* Dispatch latency against the number of listeners of the pushed event. */
+    void BM_PushEvent_ListenerCount(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.ListenerCount");
+        std::vector<int> objects(1);
+        AddListeners(eventId, (int)state.range(0), objects);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_ListenerCount)->RangeMultiplier(4)->Range(1, 4096);
+
+    /* Address-filtered push: 1024 listeners on one event, of which only range(0) belong to the pushed object. */
+    void BM_PushEvent_Selectivity(benchmark::State &state)
+    {
+        const int total = 1024;
+        EventId eventId = RegisterEventName("Bench.Selectivity");
+        std::vector<int> objects((std::size_t)(total / state.range(0)));
+        AddListeners(eventId, total, objects);
+        void *target = &objects[0];
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(target, eventId, 1));
+        state.counters["matching"] = (double)state.range(0);
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_Selectivity)->RangeMultiplier(4)->Range(1, 1024);
+
+    /* One listener on the pushed event while range(0) other events hold one listener each. */
+    void BM_PushEvent_RegistrySize(benchmark::State &state)
+    {
+        std::vector<int> objects(1);
+        std::vector<EventId> others;
+        for (int i = 0; i < state.range(0); ++i)
+        {
+            others.push_back(RegisterEventName("Bench.Other." + std::to_string(i)));
+            AddListeners(others.back(), 1, objects);
+        }
+        EventId eventId = RegisterEventName("Bench.RegistrySize");
+        AddListeners(eventId, 1, objects);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        for (EventId other : others)
+            DeleteEventListeners(other);
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_RegistrySize)->RangeMultiplier(10)->Range(1, 100000);
+
+    /* 8 listeners with call timing off (0), on for every call (1) or for one call in range(0). */
+    void BM_PushEvent_Sampling(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Sampling");
+        std::vector<int> objects(1);
+        AddListeners(eventId, 8, objects);
+        SetListenerSampling((std::uint32_t)state.range(0));
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        SetListenerSampling(0);
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_Sampling)->Arg(0)->Arg(1)->Arg(64);
+
+    /* Argument size, with 8 listeners taking the payload by const reference. */
+    void BM_PushEvent_ArgSize_ConstRef(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.ArgSize.ConstRef");
+        for (int i = 0; i < 8; ++i)
+            CreateEventListener(nullptr, eventId, [](SEvent, const std::vector<char> &payload) { benchmark::DoNotOptimize(payload.data()); });
+        std::vector<char> payload((std::size_t)state.range(0));
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, payload));
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_ArgSize_ConstRef)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+    /* Argument size, with 8 listeners taking the payload by value (one copy each). */
+    void BM_PushEvent_ArgSize_Value(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.ArgSize.Value");
+        for (int i = 0; i < 8; ++i)
+            CreateEventListener(nullptr, eventId, [](SEvent, std::vector<char> payload) { benchmark::DoNotOptimize(payload.data()); });
+        std::vector<char> payload((std::size_t)state.range(0));
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, payload));
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_ArgSize_Value)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+    /* Every thread pushes the same event, which has 8 listeners. */
+    void BM_PushEvent_Threads_SameEvent(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Threads.Same");
+        std::vector<int> objects(1);
+        if (state.thread_index() == 0)
+            AddListeners(eventId, 8, objects);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        if (state.thread_index() == 0)
+            DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_Threads_SameEvent)->ThreadRange(1, 16)->UseRealTime();
+
+    /* Every thread pushes its own event, each with 8 listeners, so threads land on different shards. */
+    void BM_PushEvent_Threads_OwnEvent(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Threads.Own." + std::to_string(state.thread_index()));
+        std::vector<int> objects(1);
+        AddListeners(eventId, 8, objects);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_Threads_OwnEvent)->ThreadRange(1, 16)->UseRealTime();
+
+    /* Creating and deleting one listener in a registry already holding range(0) listeners of the same event. */
+    void BM_CreateDeleteListener(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Churn");
+        std::vector<int> objects(64);
+        AddListeners(eventId, (int)state.range(0), objects);
+        int object = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(DeleteEventListener(CreateEventListener(&object, eventId, &OnInt)));
+        DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_CreateDeleteListener)->RangeMultiplier(10)->Range(1, 100000);
+
+    /* Deleting range(0) listeners one by one versus in a single batch. */
+    void BM_DeleteEventListener_Single(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Delete.Single");
+        std::vector<int> objects(64);
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            std::vector<int> ids = AddListeners(eventId, (int)state.range(0), objects);
+            state.ResumeTiming();
+            for (int id : ids)
+                DeleteEventListener(id);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_DeleteEventListener_Single)->RangeMultiplier(10)->Range(10, 10000);
+
+    void BM_DeleteEventListeners_Batch(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.Delete.Batch");
+        std::vector<int> objects(64);
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            std::vector<int> ids = AddListeners(eventId, (int)state.range(0), objects);
+            state.ResumeTiming();
+            DeleteEventListeners(ids);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_DeleteEventListeners_Batch)->RangeMultiplier(10)->Range(10, 10000);
+
+    /* Thread 0 keeps creating and deleting listeners of the pushed event while the other threads push it. */
+    void BM_PushEvent_WhileChurning(benchmark::State &state)
+    {
+        EventId eventId = RegisterEventName("Bench.PushWhileChurning");
+        std::vector<int> objects(1);
+        if (state.thread_index() == 0)
+            AddListeners(eventId, 8, objects);
+        int object = 0;
+        for (auto _ : state)
+        {
+            if (state.thread_index() == 0)
+                DeleteEventListener(CreateEventListener(&object, eventId, &OnInt));
+            else
+                benchmark::DoNotOptimize(PushEvent(eventId, 1));
+        }
+        if (state.thread_index() == 0)
+            DeleteEventListeners(eventId);
+    }
+    BENCHMARK(BM_PushEvent_WhileChurning)->ThreadRange(2, 16)->UseRealTime();
+}
+
+/* Same as BENCHMARK_MAIN, but writes JSON results to a file unless told otherwise. */
+int main(int argc, char **argv)
+{
+    std::vector<char *> args(argv, argv + argc);
+    bool hasOut = false;
+    for (int i = 1; i < argc; ++i)
+        hasOut |= std::string(argv[i]).rfind("--benchmark_out=", 0) == 0;
+    char out[] = "--benchmark_out=eventlistener_benchmarks.json";
+    char format[] = "--benchmark_out_format=json";
+    if (!hasOut)
+    {
+        args.push_back(out);
+        args.push_back(format);
+    }
+    int count = (int)args.size();
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,13 @@
+/**
+ * @file eventlistener.cpp
+ * @brief The non-template part of the library, for builds that define EVENTLISTENER_SEPARATE_COMPILATION.
+ *
+ * Compile this file once (with the same configuration macros as the rest of the program) and link it in; the
+ * header then only holds declarations and templates.
+ */
+
+#ifndef EVENTLISTENER_SEPARATE_COMPILATION
+#define EVENTLISTENER_SEPARATE_COMPILATION
+#endif
+#define EVENTLISTENER_IMPLEMENTATION
+#include "eventlistener.hpp"
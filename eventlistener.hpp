@@ -15,185 +15,2645 @@
 #include <functional>
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
+#include <iterator>
+#include <string>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string_view>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <initializer_list>
+#include <array>
+#include <cstdio>
+#include <chrono>
+#include <optional>
 
+/* Number of independently locked shards the listener registry is split into. */
+#ifndef EVENTLISTENER_SHARDS
+#define EVENTLISTENER_SHARDS 16
+#endif
+
+/* Bytes of inline storage for a listener's callable (see InplaceFunction). */
+#ifndef EVENTLISTENER_INPLACE_SIZE
+#define EVENTLISTENER_INPLACE_SIZE 64
+#endif
+
+/*
+ * By default every function is inline, so the header can be included from any number of translation units. With
+ * EVENTLISTENER_SEPARATE_COMPILATION defined everywhere, the header keeps only declarations and templates, and
+ * the non-template code is compiled once, in the one translation unit that also defines
+ * EVENTLISTENER_IMPLEMENTATION (eventlistener.cpp does). Configuration macros must then match in every unit.
+ */
+#ifdef EVENTLISTENER_SEPARATE_COMPILATION
+#define EVENTLISTENER_API
+#else
+#define EVENTLISTENER_API inline
+#endif
+
+/*
+ * Tracing levels: 0 off, 1 errors, 2 warnings, 3 debug (registry changes), 4 trace (every push and listener
+ * call). Only messages up to EVENTLISTENER_LOG_LEVEL are compiled in; the rest expand to nothing, so a
+ * release build pays nothing for them. Defining __DEBUG still turns everything on.
+ */
+#ifndef EVENTLISTENER_LOG_LEVEL
 #ifdef __DEBUG
-#include <iostream>
-void EventListenerLog(const char* text)
+#define EVENTLISTENER_LOG_LEVEL 4
+#else
+#define EVENTLISTENER_LOG_LEVEL 0
+#endif
+#endif
+
+#if EVENTLISTENER_LOG_LEVEL >= 1
+#define EVENTLISTENER_ERROR(text) ::EventListener::WriteLog(::EventListener::ELogLevel::Error, text)
+#else
+#define EVENTLISTENER_ERROR(text) ((void)0)
+#endif
+
+#if EVENTLISTENER_LOG_LEVEL >= 2
+#define EVENTLISTENER_WARN(text) ::EventListener::WriteLog(::EventListener::ELogLevel::Warning, text)
+#else
+#define EVENTLISTENER_WARN(text) ((void)0)
+#endif
+
+#if EVENTLISTENER_LOG_LEVEL >= 3
+#define EVENTLISTENER_DEBUG(text) ::EventListener::WriteLog(::EventListener::ELogLevel::Debug, text)
+#else
+#define EVENTLISTENER_DEBUG(text) ((void)0)
+#endif
+
+#if EVENTLISTENER_LOG_LEVEL >= 4
+#define EVENTLISTENER_TRACE(text) ::EventListener::WriteLog(::EventListener::ELogLevel::Trace, text)
+#else
+#define EVENTLISTENER_TRACE(text) ((void)0)
+#endif
+
+/*
+ * USDT (systemtap SDT) probes for perf and bpftrace, provider "eventlistener": push__entry(event, address),
+ * push__return(event, address, called), listener__entry(event, name, listener, address) and
+ * listener__return(event, listener). Each is a single nop until a tracer attaches. They are compiled in
+ * whenever <sys/sdt.h> is available; define EVENTLISTENER_USDT as 0 to leave them out.
+ */
+#ifndef EVENTLISTENER_USDT
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define EVENTLISTENER_USDT 1
+#endif
+#endif
+#endif
+#ifndef EVENTLISTENER_USDT
+#define EVENTLISTENER_USDT 0
+#endif
+
+#if EVENTLISTENER_USDT
+#include <sys/sdt.h>
+#define EVENTLISTENER_PROBE2(probe, a, b) DTRACE_PROBE2(eventlistener, probe, a, b)
+#define EVENTLISTENER_PROBE3(probe, a, b, c) DTRACE_PROBE3(eventlistener, probe, a, b, c)
+#define EVENTLISTENER_PROBE4(probe, a, b, c, d) DTRACE_PROBE4(eventlistener, probe, a, b, c, d)
+#else
+#define EVENTLISTENER_PROBE2(probe, a, b) ((void)0)
+#define EVENTLISTENER_PROBE3(probe, a, b, c) ((void)0)
+#define EVENTLISTENER_PROBE4(probe, a, b, c, d) ((void)0)
+#endif
+
+namespace EventListener
 {
-    std::cout << text << std::endl;
+    enum class ELogLevel { Off, Error, Warning, Debug, Trace };
+
+    /* Receives every message that was compiled in. `text` is always a string literal. */
+    using LogSink = void (*)(ELogLevel level, const char *text);
+
+    /* The default sink: one line per message on stderr, with no flush per line. */
+    EVENTLISTENER_API void WriteLogLine(ELogLevel level, const char *text);
+
+    inline std::atomic<LogSink> g_log_sink{&WriteLogLine};
+
+    /*
+     * Asynchronous logging: messages are queued as (level, literal) pairs, so queuing never formats or copies
+     * text, and a background thread hands them to the sink in batches.
+     */
+    struct SAsyncLog
+    {
+        std::mutex lifecycle; // serializes Start and Stop, including the join, so `writer` is never replaced while joinable
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<std::pair<ELogLevel, const char *>> pending;
+        std::atomic<bool> running{false};
+        std::thread writer;
+
+        void Run()
+        {
+            std::vector<std::pair<ELogLevel, const char *>> batch;
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                wake.wait(lock, [this] { return !pending.empty() || !running.load(std::memory_order_relaxed); });
+                if (pending.empty())
+                    return;
+                batch.swap(pending);
+                lock.unlock();
+                LogSink sink = g_log_sink.load(std::memory_order_acquire);
+                for (const auto &message : batch)
+                    sink(message.first, message.second);
+                batch.clear();
+                lock.lock();
+            }
+        }
+
+        void Start()
+        {
+            const std::lock_guard<std::mutex> guard(lifecycle);
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (running.load(std::memory_order_relaxed))
+                return;
+            running.store(true, std::memory_order_relaxed);
+            writer = std::thread([this] { Run(); });
+        }
+
+        void Stop()
+        {
+            const std::lock_guard<std::mutex> guard(lifecycle);
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                if (!running.load(std::memory_order_relaxed))
+                    return;
+                running.store(false, std::memory_order_relaxed);
+            }
+            wake.notify_one();
+            writer.join();
+        }
+
+        ~SAsyncLog() { Stop(); }
+    };
+
+    inline SAsyncLog g_async_log;
+
+    /* Called by the EVENTLISTENER_* macros. */
+    EVENTLISTENER_API void WriteLog(ELogLevel level, const char *text);
+
+    /* Replaces the sink messages are written to; nullptr restores the default stderr sink. */
+    EVENTLISTENER_API void SetLogSink(LogSink sink);
+
+    /* Moves sink calls to a background thread, so logging threads only append to a queue. */
+    EVENTLISTENER_API void StartAsyncLogging();
+
+    /* Writes out everything still queued and goes back to calling the sink directly. */
+    EVENTLISTENER_API void StopAsyncLogging();
+
+    /* A non-owning view of contiguous elements, used by the batch functions. */
+    template <typename T>
+    class Span
+    {
+    public:
+        Span() = default;
+        Span(T *data, std::size_t size) : m_data(data), m_size(size) {}
+        Span(std::initializer_list<std::remove_const_t<T>> list) : m_data(std::data(list)), m_size(list.size()) {}
+
+        template <typename C, typename = std::enable_if_t<std::is_convertible_v<decltype(std::data(std::declval<C &>())), T *>>>
+        Span(C &&container) : m_data(std::data(container)), m_size(std::size(container)) {}
+
+        T *data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        T &operator[](std::size_t i) const { return m_data[i]; }
+        T *begin() const { return m_data; }
+        T *end() const { return m_data + m_size; }
+
+    private:
+        T *m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    /* Compact handle for an interned event name. Equal names always intern to the same handle. */
+    enum class EventId : std::uint32_t { Invalid = 0 };
+
+    /* 64-bit FNV-1a. Usable at compile time, see operator""_evt. */
+    constexpr std::uint64_t HashEventName(std::string_view name)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (char c : name)
+            hash = (hash ^ (std::uint8_t)c) * 1099511628211ull;
+        return hash;
+    }
+
+    /* An event name together with its hash, both known at compile time when made by the _evt literal. */
+    struct EventName
+    {
+        std::uint64_t hash;
+        std::string_view name;
+
+        constexpr operator std::uint64_t() const { return hash; }
+    };
+
+    /* "Name"_evt; converts to its hash, so it can also be used as a template argument: PushEvent<"Name"_evt>(...). */
+    constexpr EventName operator""_evt(const char *name, std::size_t size)
+    {
+        return EventName{HashEventName(std::string_view(name, size)), std::string_view(name, size)};
+    }
+
+    /* What a name hash resolves to. The name tells a hash collision apart from a match. */
+    struct SEventHash
+    {
+        EventId id;
+        std::string_view name;
+    };
+
+    inline std::deque<std::string> g_event_names{};
+    inline std::unordered_map<std::string_view, EventId> g_event_ids{};
+    inline std::unordered_map<std::uint64_t, SEventHash> g_event_hashes{};
+    inline std::shared_mutex g_event_names_mutex;
+
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+    /*
+     * Copy-on-write mode: RegisterEventName publishes an immutable copy of the name maps, so the lookups on the
+     * push path (LookupEventName, LookupEventHash) read it without taking g_event_names_mutex. Replaced copies
+     * are retired and freed like replaced shard tables.
+     */
+    template <typename T>
+    struct SRetiredTable
+    {
+        const T *table;
+        std::uint64_t birth;   // the epoch the table was published in
+        std::uint64_t retired; // the epoch it was replaced in
+    };
+
+    struct SEventNameTable
+    {
+        std::unordered_map<std::string_view, EventId> ids;
+        std::unordered_map<std::uint64_t, SEventHash> hashes;
+    };
+
+    struct SEventNameTables
+    {
+        std::atomic<const SEventNameTable *> current{nullptr};
+        std::uint64_t birth = 0;
+        std::vector<SRetiredTable<SEventNameTable>> retired{};
+
+        SEventNameTables() = default;
+        SEventNameTables(const SEventNameTables &) = delete;
+        SEventNameTables &operator=(const SEventNameTables &) = delete;
+
+        /* Nothing can be looking names up any more once the tables are destroyed at exit. */
+        ~SEventNameTables()
+        {
+            delete current.load();
+            for (const SRetiredTable<SEventNameTable> &old : retired)
+                delete old.table;
+        }
+    };
+
+    inline SEventNameTables g_event_name_tables;
+#endif
+
+    EVENTLISTENER_API EventId LookupEventName(std::string_view name);
+
+    /* Looks the name up by its precomputed hash, and by the name itself only if another name has that hash. */
+    EVENTLISTENER_API EventId LookupEventName(const EventName &eventName);
+
+    EVENTLISTENER_API EventId RegisterEventName(std::string_view name);
+
+    EVENTLISTENER_API EventId RegisterEventName(const EventName &name);
+
+    /* Returns the handle of the first registered name with this hash, or EventId::Invalid. Only use it when no two names can collide. */
+    EVENTLISTENER_API EventId LookupEventHash(std::uint64_t hash);
+
+    /*
+     * The handle of the event with this name hash, cached per hash once the name is registered, so later calls
+     * are a single relaxed load with no hashing, lookup or locking.
+     */
+    template <std::uint64_t Hash>
+    EventId StaticEventId()
+    {
+        static std::atomic<EventId> cached{EventId::Invalid};
+        EventId id = cached.load(std::memory_order_relaxed);
+        if (id == EventId::Invalid)
+        {
+            id = LookupEventHash(Hash);
+            cached.store(id, std::memory_order_relaxed);
+        }
+        return id;
+    }
+
+    EVENTLISTENER_API std::string_view GetEventName(EventId id);
+
+    struct SEvent
+    {
+        int id;
+        uintptr_t address;
+        std::string_view name;
+        EventId event;
+    };
+
+    template <typename... arguments>
+    using EventFunction = std::function<void(SEvent, arguments...)>;
+
+    /* One tag object per argument list, so a listener's signature can be compared with a push's in one compare. */
+    template <typename... arguments>
+    struct SSignature
+    {
+        static constexpr char tag = 0;
+    };
+
+    template <typename... arguments>
+    constexpr const void *SignatureOf()
+    {
+        return &SSignature<std::decay_t<arguments>...>::tag;
+    }
+
+    /* How arguments are handed on without copies: reference parameters stay as they are, values become const references. */
+    template <typename T>
+    using ParameterOf = std::conditional_t<std::is_reference_v<T>, T, const T &>;
+
+    /*
+     * A copyable callable kept in a fixed-size buffer inside the object itself, so calling it is a single
+     * indirect call with no separately allocated target. Arguments declared by value are passed through by
+     * const reference, so only a target taking them by value copies them.
+     */
+    template <typename Signature, std::size_t Capacity = EVENTLISTENER_INPLACE_SIZE>
+    class InplaceFunction;
+
+    template <typename R, typename... A, std::size_t Capacity>
+    class InplaceFunction<R(A...), Capacity>
+    {
+    public:
+        InplaceFunction() noexcept = default;
+        InplaceFunction(std::nullptr_t) noexcept {}
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction>>>
+        InplaceFunction(F &&fn)
+        {
+            using T = std::decay_t<F>;
+            static_assert(sizeof(T) <= Capacity, "Callable does not fit in InplaceFunction; raise EVENTLISTENER_INPLACE_SIZE or wrap it in an EventFunction.");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Callable is over-aligned for InplaceFunction.");
+            new (m_storage) T(std::forward<F>(fn));
+            m_invoke = [](void *target, ParameterOf<A>...args) -> R
+                {
+                    return (*static_cast<T *>(target))(std::forward<ParameterOf<A>>(args)...);
+                };
+            m_manage = [](EOperation operation, void *target, void *source)
+                {
+                    switch (operation)
+                    {
+                    case EOperation::Copy:
+                        new (target) T(*static_cast<const T *>(source));
+                        break;
+                    case EOperation::Move:
+                        new (target) T(std::move(*static_cast<T *>(source)));
+                        static_cast<T *>(source)->~T();
+                        break;
+                    case EOperation::Destroy:
+                        static_cast<T *>(target)->~T();
+                        break;
+                    }
+                };
+        }
+
+        InplaceFunction(const InplaceFunction &other) : m_invoke(other.m_invoke), m_manage(other.m_manage)
+        {
+            if (m_manage)
+                m_manage(EOperation::Copy, m_storage, other.m_storage);
+        }
+
+        InplaceFunction(InplaceFunction &&other) noexcept : m_invoke(other.m_invoke), m_manage(other.m_manage)
+        {
+            if (m_manage)
+                m_manage(EOperation::Move, m_storage, other.m_storage);
+            other.m_invoke = nullptr;
+            other.m_manage = nullptr;
+        }
+
+        InplaceFunction &operator=(InplaceFunction other) noexcept
+        {
+            this->~InplaceFunction();
+            return *new (this) InplaceFunction(std::move(other));
+        }
+
+        ~InplaceFunction()
+        {
+            if (m_manage)
+                m_manage(EOperation::Destroy, m_storage, nullptr);
+        }
+
+        explicit operator bool() const noexcept { return m_invoke != nullptr; }
+
+        R operator()(ParameterOf<A>...args) const { return m_invoke(m_storage, std::forward<ParameterOf<A>>(args)...); }
+
+    private:
+        enum class EOperation { Copy, Move, Destroy };
+
+        alignas(std::max_align_t) mutable unsigned char m_storage[Capacity];
+        R (*m_invoke)(void *, ParameterOf<A>...) = nullptr;
+        void (*m_manage)(EOperation, void *, void *) = nullptr;
+    };
+
+    /* How every registry listener is stored: the pushed arguments arrive as an array of pointers to const values. */
+    using ListenerFunction = InplaceFunction<void(const SEvent &, const void *const *)>;
+
+    template <typename... arguments, typename F, std::size_t... I>
+    void InvokeListener(F &fn, const SEvent &event, const void *const *argv, std::index_sequence<I...>)
+    {
+        fn(event, *static_cast<const std::decay_t<arguments> *>(argv[I])...);
+    }
+
+    /* Wraps `fn`, callable as fn(SEvent, arguments...), into a ListenerFunction that holds it inline. */
+    template <typename... arguments, typename F>
+    ListenerFunction MakeListenerFunction(F &&fn)
+    {
+        static_assert(((!std::is_reference_v<arguments> || std::is_const_v<std::remove_reference_t<arguments>>) && ...),
+            "Listener arguments must be taken by value or by const reference.");
+        return [fn = std::forward<F>(fn)](const SEvent &event, const void *const *argv) mutable
+            {
+                InvokeListener<arguments...>(fn, event, argv, std::index_sequence_for<arguments...>());
+            };
+    }
+
+    /* Deduces a listener's argument types (the ones after SEvent) from its call operator. */
+    template <typename F>
+    struct SListenerTraits : SListenerTraits<decltype(&F::operator())> {};
+
+    template <typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (*)(E, arguments...)>
+    {
+        static const void *Signature() { return SignatureOf<arguments...>(); }
+
+        template <typename F>
+        static ListenerFunction Make(F &&fn) { return MakeListenerFunction<arguments...>(std::forward<F>(fn)); }
+    };
+
+    template <typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (*)(E, arguments...) noexcept> : SListenerTraits<R (*)(E, arguments...)> {};
+    template <typename C, typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (C::*)(E, arguments...)> : SListenerTraits<R (*)(E, arguments...)> {};
+    template <typename C, typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (C::*)(E, arguments...) const> : SListenerTraits<R (*)(E, arguments...)> {};
+    template <typename C, typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (C::*)(E, arguments...) noexcept> : SListenerTraits<R (*)(E, arguments...)> {};
+    template <typename C, typename R, typename E, typename... arguments>
+    struct SListenerTraits<R (C::*)(E, arguments...) const noexcept> : SListenerTraits<R (*)(E, arguments...)> {};
+
+    /*
+     * Listener call latencies in nanoseconds, HDR style: below 8 ns every value has its own bucket, and above
+     * that every power of two is split into 4 buckets, so a bucket is never wider than a quarter of its values.
+     * Everything from 2^36 ns (about 69 s) up lands in the last bucket.
+     */
+    struct SLatencyHistogram
+    {
+        // 8 single values, 4 buckets for each power of two from 2^3 to 2^35, and one for 2^36 and up.
+        static constexpr std::size_t kBuckets = 8 + 33 * 4 + 1;
+
+        std::array<std::uint64_t, kBuckets> counts{};
+
+        static constexpr std::size_t BucketOf(std::uint64_t nanoseconds)
+        {
+            if (nanoseconds < 8)
+                return (std::size_t)nanoseconds;
+            int exponent = 3;
+            while (exponent < 36 && (nanoseconds >> (exponent + 1)) != 0)
+                ++exponent;
+            if (exponent == 36)
+                return kBuckets - 1;
+            return 8 + (std::size_t)(exponent - 3) * 4 + (std::size_t)((nanoseconds >> (exponent - 2)) & 3);
+        }
+
+        /* The smallest value counted in `bucket`. */
+        static constexpr std::uint64_t LowerBound(std::size_t bucket)
+        {
+            if (bucket < 8)
+                return bucket;
+            return (std::uint64_t)(4 + (bucket - 8) % 4) << (1 + (bucket - 8) / 4);
+        }
+
+        std::uint64_t Total() const
+        {
+            std::uint64_t total = 0;
+            for (std::uint64_t count : counts)
+                total += count;
+            return total;
+        }
+
+        /* The largest value of the bucket holding the given percentile (0 to 100), or 0 if nothing was recorded. */
+        std::uint64_t Percentile(double percentile) const
+        {
+            std::uint64_t total = Total();
+            if (total == 0)
+                return 0;
+            std::uint64_t rank = std::max<std::uint64_t>(1, (std::uint64_t)(percentile / 100.0 * (double)total + 0.5));
+            std::uint64_t seen = 0;
+            for (std::size_t bucket = 0; bucket + 1 < kBuckets; ++bucket)
+                if ((seen += counts[bucket]) >= rank)
+                    return LowerBound(bucket + 1) - 1;
+            return LowerBound(kBuckets - 1);
+        }
+    };
+
+    /*
+     * Updated by every call of a listener; the histogram is only allocated once a call of it is timed. They sit
+     * on their own cache line, so counting calls does not invalidate the line holding the listener's callable
+     * and flags, which every dispatching thread reads.
+     */
+    struct alignas(64) SListenerCounters
+    {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> exceptions{0};
+        std::atomic<std::uint64_t> sampled{0};
+        std::atomic<std::uint64_t> totalNanoseconds{0};
+        std::atomic<std::atomic<std::uint64_t> *> latency{nullptr};
+
+        SListenerCounters() = default;
+        SListenerCounters(const SListenerCounters &) = delete;
+        SListenerCounters &operator=(const SListenerCounters &) = delete;
+        ~SListenerCounters() { delete[] latency.load(std::memory_order_relaxed); }
+    };
+
+    struct SListener
+    {
+        int id;
+        void *address;
+        EventId event;
+        std::string_view name;
+        const void *signature;
+        ListenerFunction fn;
+        int priority;
+        std::atomic<bool> removed{false};
+        mutable SListenerCounters counters{};
+
+        SListener(int id, void *address, EventId event, std::string_view name, const void *signature, ListenerFunction fn, int priority)
+            : id(id), address(address), event(event), name(name), signature(signature), fn(std::move(fn)), priority(priority) {}
+    };
+
+    /*
+     * Every listener of one event, plus the same listeners indexed by object address. Deleted listeners are
+     * only flagged as removed and counted; the lists are compacted in place once half of them are removed.
+     */
+    struct SEventBucket
+    {
+        std::vector<const SListener *> listeners;
+        std::unordered_map<void *, std::vector<const SListener *>> objects;
+        std::size_t removed = 0;
+    };
+
+    using SEventTable = std::unordered_map<EventId, SEventBucket>;
+
+    /*
+     * Listener records live in a generational slot map. An ID holds the slot index in its low bits and the
+     * slot's generation in the high bits, so it resolves in O(1), and an ID whose slot has been retired (and
+     * maybe reused) no longer matches. Generations run from 1 to kSlotGenerationMask and then wrap back to 1,
+     * so no ID is ever 0 and IDs never run out. Freed slots are reused oldest first, and only once
+     * kFreeSlotReserve newer ones are queued behind them, so a stale ID can only match again after its shard
+     * has deleted about kFreeSlotReserve * kSlotGenerationMask (half a million) listeners since.
+     */
+    constexpr int kSlotIndexBits = 20;
+    constexpr std::uint32_t kSlotIndexMask = (1u << kSlotIndexBits) - 1;
+    constexpr std::uint32_t kSlotGenerationMask = (1u << (31 - kSlotIndexBits)) - 1;
+    constexpr std::size_t kFreeSlotReserve = 256;
+
+    /*
+     * Records are stored in place in slabs of kSlabSize slots, so listeners registered together sit next to
+     * each other in memory rather than in separate allocations. Slabs are never moved or freed, which keeps
+     * the pointers held by the event tables valid; a retired slot keeps its record until ReclaimRetired.
+     * Every slab belongs to one registry shard, which hands out its slots, keeps its free list and guards
+     * its records with the shard's lock, so creating and deleting listeners in different shards never
+     * share a lock. Slabs are claimed from the global table below with one atomic increment.
+     */
+    constexpr std::uint32_t kSlabSize = 256;
+    constexpr std::uint32_t kSlabCount = (kSlotIndexMask + 1) / kSlabSize;
+
+    struct SListenerSlot
+    {
+        std::optional<SListener> listener;
+        std::uint32_t generation = 1;
+        std::uint64_t birth = 0; // the epoch the record was created in (see SReadSection)
+    };
+
+    struct SListenerSlab
+    {
+        SListenerSlot slots[kSlabSize];
+        std::size_t shard; // index of the owning shard in g_shards
+    };
+
+    struct SListenerSlabs
+    {
+        std::atomic<SListenerSlab *> slabs[kSlabCount] = {};
+        std::atomic<std::uint32_t> count{0};
+
+        SListenerSlabs() = default;
+        SListenerSlabs(const SListenerSlabs &) = delete;
+        SListenerSlabs &operator=(const SListenerSlabs &) = delete;
+
+        /* Nothing can be dispatching any more once the slabs are destroyed at exit. */
+        ~SListenerSlabs()
+        {
+            for (std::atomic<SListenerSlab *> &slab : slabs)
+                delete slab.load();
+        }
+    };
+
+    inline SListenerSlabs g_listener_slabs;
+
+    /* Returns the slab holding this ID's slot, or nullptr if there is none. */
+    inline SListenerSlab *SlabOf(int id)
+    {
+        if (id <= 0)
+            return nullptr;
+        return g_listener_slabs.slabs[((std::uint32_t)id & kSlotIndexMask) / kSlabSize].load(std::memory_order_acquire);
+    }
+
+    /* Caller holds the lock of the shard owning the slot's slab. */
+    inline SListenerSlot &SlotAt(std::uint32_t index)
+    {
+        return g_listener_slabs.slabs[index / kSlabSize].load(std::memory_order_relaxed)->slots[index % kSlabSize];
+    }
+
+    /* Returns the live record with this ID, or nullptr for unknown and stale IDs. Caller holds the lock of the shard owning the ID's slab. */
+    inline SListener *FindListener(int id)
+    {
+        if (SlabOf(id) == nullptr)
+            return nullptr;
+        SListenerSlot &slot = SlotAt((std::uint32_t)id & kSlotIndexMask);
+        if (slot.generation != ((std::uint32_t)id >> kSlotIndexBits) || !slot.listener)
+            return nullptr;
+        return &*slot.listener;
+    }
+
+    /* A snapshot of one listener's counters (see GetListenerStats). */
+    struct SListenerStats
+    {
+        int id;
+        EventId event;
+        std::string_view name;
+        std::uint64_t calls;
+        std::uint64_t exceptions;
+        std::uint64_t sampled;
+        std::uint64_t totalNanoseconds;
+        SLatencyHistogram latency;
+    };
+
+    /* 0 (the default) times no calls, 1 times every call, N times one call in N of each listener. */
+    inline std::atomic<std::uint32_t> g_listener_sampling{0};
+
+    /* Sets how often listener calls are timed. Call counts and exception counts are always kept. */
+    EVENTLISTENER_API void SetListenerSampling(std::uint32_t period);
+
+    /* Counters of every live listener registered with CreateEventListener or Subscribe. */
+    EVENTLISTENER_API std::vector<SListenerStats> GetListenerStats();
+
+    /*
+     * Listener records removed from the registry (and, in copy-on-write mode, replaced tables) are retired
+     * rather than freed. g_epoch advances on every retirement, and each retired item remembers the epoch it
+     * was created in and the one it was retired in. Every thread reading the registry publishes, in its own
+     * cache-line padded record, the epoch its outermost read section began in (lower) and the newest epoch
+     * whose data it may have read (upper). A retired item is freed once no record's [lower, upper] overlaps
+     * its lifetime, so a long dispatch only holds back what it could have seen, never what was created and
+     * retired while it ran.
+     */
+    constexpr std::uint64_t kIdleEpoch = ~(std::uint64_t)0;
+
+    inline std::atomic<std::uint64_t> g_epoch{1};
+
+    struct alignas(64) SReaderRecord
+    {
+        std::atomic<std::uint64_t> lower{kIdleEpoch};
+        std::atomic<std::uint64_t> upper{0};
+        std::atomic<bool> used{false};
+        std::size_t depth = 0; // only touched by the owning thread
+        SReaderRecord *next = nullptr;
+    };
+
+    /* One record per thread that has read the registry, reused once that thread exits. Records are never freed. */
+    inline std::atomic<SReaderRecord *> g_reader_records{nullptr};
+
+    EVENTLISTENER_API SReaderRecord *AcquireReaderRecord();
+
+    EVENTLISTENER_API void ReleaseReaderRecord(SReaderRecord *record);
+
+    struct SReaderHandle
+    {
+        SReaderRecord *record = AcquireReaderRecord();
+
+        ~SReaderHandle() { ReleaseReaderRecord(record); }
+    };
+
+    inline SReaderRecord &ReaderRecord()
+    {
+        thread_local SReaderHandle handle;
+        return *handle.record;
+    }
+
+    /*
+     * Keeps everything this thread reads from the registry alive while in scope. Until Seal() it protects
+     * every item not yet retired when it began; Seal(), called once the reads are done, narrows that to the
+     * items that existed by then. Sections nest.
+     */
+    struct SReadSection
+    {
+        SReaderRecord &record;
+        std::uint64_t previous;
+
+        SReadSection() : record(ReaderRecord()), previous(record.upper.load(std::memory_order_relaxed))
+        {
+            if (record.depth++ == 0)
+            {
+                record.upper.store(kIdleEpoch, std::memory_order_relaxed);
+                record.lower.store(g_epoch.load());
+            }
+            else
+                record.upper.store(kIdleEpoch);
+        }
+
+        ~SReadSection()
+        {
+            if (--record.depth == 0)
+            {
+                record.lower.store(kIdleEpoch, std::memory_order_release);
+                record.upper.store(0, std::memory_order_release);
+            }
+            else
+                record.upper.store(previous, std::memory_order_release);
+        }
+
+        SReadSection(const SReadSection &) = delete;
+        SReadSection &operator=(const SReadSection &) = delete;
+
+        void Seal() { record.upper.store(std::max(previous, g_epoch.load()), std::memory_order_release); }
+    };
+
+    /* Whether a thread inside a read section may still hold an item that existed from epoch `birth` to `retired`. */
+    EVENTLISTENER_API bool MayBeInUse(std::uint64_t birth, std::uint64_t retired);
+
+    /* A listener slot waiting for every thread that may be dispatching to its record to finish. */
+    struct SRetiredSlot
+    {
+        std::uint32_t index;
+        std::uint64_t birth;
+        std::uint64_t retired;
+    };
+
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+    /* Frees the retired tables no thread can still be reading. Caller holds the lock their owner's writers take. */
+    template <typename T>
+    void ReclaimRetiredTables(std::vector<SRetiredTable<T>> &retired)
+    {
+        auto kept = retired.begin();
+        for (const SRetiredTable<T> &old : retired)
+        {
+            if (MayBeInUse(old.birth, old.retired))
+                *kept++ = old;
+            else
+                delete old.table;
+        }
+        retired.erase(kept, retired.end());
+    }
+#endif
+
+    /* IDs of the listeners the table edit running on this thread has unlinked; ModifyEventTable retires them. */
+    inline thread_local std::vector<int> t_unlinked_listeners{};
+
+    /*
+     * The registry is split into EVENTLISTENER_SHARDS shards by EventId, each with its own lock and table, so
+     * registrations and pushes on events in different shards do not contend. Every shard counts how often its
+     * lock was taken and how often that had to wait for another thread.
+     */
+    struct alignas(64) SEventShard
+    {
+        std::mutex mutex;
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contentions{0};
+        /* The shard's part of the slot map: free slots (reused oldest first), retired slots and the slab being filled. */
+        std::deque<std::uint32_t> freeSlots{};
+        std::vector<SRetiredSlot> retiredSlots{};
+        std::uint32_t slab = 0;
+        std::uint32_t slabUsed = kSlabSize;
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        /*
+         * Copy-on-write mode: writers copy the shard's current table under its mutex, edit the copy and publish
+         * it with one atomic store. PushEvent reads the published table without taking any lock.
+         */
+        std::atomic<const SEventTable *> table{nullptr};
+        std::uint64_t birth = 0; // of the published table
+        std::vector<SRetiredTable<SEventTable>> retired{};
+
+        SEventShard() = default;
+        SEventShard(const SEventShard &) = delete;
+        SEventShard &operator=(const SEventShard &) = delete;
+
+        /* Nothing can be dispatching any more once the shards are destroyed at exit. */
+        ~SEventShard()
+        {
+            delete table.load();
+            for (const SRetiredTable<SEventTable> &old : retired)
+                delete old.table;
+        }
+#else
+        SEventTable events{};
+#endif
+    };
+
+    inline SEventShard g_shards[EVENTLISTENER_SHARDS];
+
+    inline SEventShard &ShardOf(EventId eventId)
+    {
+        return g_shards[(std::size_t)eventId % EVENTLISTENER_SHARDS];
+    }
+
+    /* Locks a shard, counting the acquisition as contended if another thread held it. */
+    struct SShardLock
+    {
+        std::unique_lock<std::mutex> lock;
+
+        explicit SShardLock(SEventShard &shard) : lock(shard.mutex, std::try_to_lock)
+        {
+            shard.acquisitions.fetch_add(1, std::memory_order_relaxed);
+            if (!lock.owns_lock())
+            {
+                shard.contentions.fetch_add(1, std::memory_order_relaxed);
+                lock.lock();
+            }
+        }
+    };
+
+    struct SShardStats
+    {
+        std::uint64_t acquisitions;
+        std::uint64_t contentions;
+    };
+
+    /* Lock counters of every shard. In copy-on-write mode only writers take shard locks. */
+    EVENTLISTENER_API std::array<SShardStats, EVENTLISTENER_SHARDS> GetShardStats();
+
+    /* Retires the slots of the listeners unlinked by the current table edit. Caller holds the shard's lock. */
+    EVENTLISTENER_API void RetireUnlinked(SEventShard &shard);
+
+    /* Frees every retired item no thread can still be reading. Caller holds the shard's lock. */
+    EVENTLISTENER_API void ReclaimRetired(SEventShard &shard);
+
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+    /* Calls `f` on a writable copy of the shard's published table and publishes the result. Caller holds the shard's lock. */
+    template <typename F>
+    int ModifyEventTable(SEventShard &shard, F f)
+    {
+        const SEventTable *current = shard.table.load();
+        SEventTable *table = current ? new SEventTable(*current) : new SEventTable();
+        int count = f(*table);
+        const std::uint64_t birth = g_epoch.load();
+        const SEventTable *old = shard.table.exchange(table);
+        shard.retired.push_back(SRetiredTable<SEventTable>{old, shard.birth, g_epoch.fetch_add(1)});
+        shard.birth = birth;
+        RetireUnlinked(shard);
+        ReclaimRetired(shard);
+        return count;
+    }
+
+    /* Keeps a shard's published table alive for as long as it is in scope. */
+    struct SEventTableReader
+    {
+        SReadSection section;
+        const SEventTable *table;
+
+        explicit SEventTableReader(SEventShard &shard) : table(shard.table.load()) { section.Seal(); }
+    };
+#else
+    /* Calls `f` on the shard's table in place. Caller holds the shard's lock. */
+    template <typename F>
+    int ModifyEventTable(SEventShard &shard, F f)
+    {
+        int count = f(shard.events);
+        RetireUnlinked(shard);
+        ReclaimRetired(shard);
+        return count;
+    }
+
+    /* One scratch list per nesting level of PushEvent on this thread, reused so dispatch does not allocate. */
+    inline thread_local std::deque<std::vector<const SListener *>> t_dispatch_lists{};
+    inline thread_local std::size_t t_dispatch_depth = 0;
+#endif
+
+    inline const std::vector<const SListener *> *FindListeners(const SEventTable &events, EventId eventId)
+    {
+        auto bucket = events.find(eventId);
+        return bucket == events.end() ? nullptr : &bucket->second.listeners;
+    }
+
+    inline const std::vector<const SListener *> *FindListeners(const SEventTable &events, void *objAddress, EventId eventId)
+    {
+        auto bucket = events.find(eventId);
+        if (bucket == events.end())
+            return nullptr;
+        auto object = bucket->second.objects.find(objAddress);
+        return object == bucket->second.objects.end() ? nullptr : &object->second;
+    }
+
+    /*
+     * The listeners a single push will call, found in one pass over the event's shard. No registry lock is held
+     * while they run, so listeners may push events or create and delete listeners themselves.
+     */
+    struct SListenerSnapshot
+    {
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        SEventTableReader reader;
+        const std::vector<const SListener *> *listeners;
+
+        template <typename F>
+        SListenerSnapshot(EventId eventId, F find) : reader(ShardOf(eventId)), listeners(reader.table ? find(*reader.table) : nullptr) {}
+#else
+        SReadSection section;
+        std::vector<const SListener *> &scratch;
+        const std::vector<const SListener *> *listeners = nullptr;
+
+        template <typename F>
+        SListenerSnapshot(EventId eventId, F find) : scratch(t_dispatch_depth < t_dispatch_lists.size() ? t_dispatch_lists[t_dispatch_depth] : t_dispatch_lists.emplace_back())
+        {
+            ++t_dispatch_depth;
+            SEventShard &shard = ShardOf(eventId);
+            const SShardLock lock(shard);
+            if (const std::vector<const SListener *> *found = find(shard.events))
+            {
+                scratch.assign(found->begin(), found->end());
+                listeners = &scratch;
+            }
+            section.Seal();
+        }
+        ~SListenerSnapshot()
+        {
+            scratch.clear();
+            --t_dispatch_depth;
+        }
+#endif
+        SListenerSnapshot(const SListenerSnapshot &) = delete;
+        SListenerSnapshot &operator=(const SListenerSnapshot &) = delete;
+    };
+
+    /*
+     * Calls one listener with the pushed arguments, which are passed by const reference all the way down. Returns
+     * false, without calling it, if the listener was registered for different argument types.
+     */
+    EVENTLISTENER_API void RecordListenerLatency(const SListener &listener, std::chrono::steady_clock::time_point start);
+
+    inline bool CallEvent(const SListener &listener, const void *signature, const void *const *argv)
+    {
+        if (listener.removed.load(std::memory_order_relaxed))
+            return false;
+        if (listener.signature != signature)
+        {
+            EVENTLISTENER_WARN("Listener arguments do not match the pushed event.");
+            return false;
+        }
+        EVENTLISTENER_TRACE("Calling listener event.");
+        const std::uint32_t period = g_listener_sampling.load(std::memory_order_relaxed);
+        const std::uint64_t call = listener.counters.calls.fetch_add(1, std::memory_order_relaxed);
+        const bool timed = period != 0 && call % period == 0;
+        EVENTLISTENER_PROBE4(listener__entry, (std::uint64_t)listener.event, listener.name.data(), listener.id, (std::uintptr_t)listener.address);
+        const std::chrono::steady_clock::time_point start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        try
+        {
+            listener.fn(SEvent{listener.id, (uintptr_t)listener.address, listener.name, listener.event}, argv);
+            EVENTLISTENER_TRACE("Successfully called listener event.");
+        } catch (std::exception &e) {
+            listener.counters.exceptions.fetch_add(1, std::memory_order_relaxed);
+            EVENTLISTENER_WARN("Listener event threw an exception.");
+        }
+        if (timed)
+            RecordListenerLatency(listener, start);
+        EVENTLISTENER_PROBE2(listener__return, (std::uint64_t)listener.event, listener.id);
+        return true;
+    }
+
+    /* Stores a new listener record and returns its ID; the public overloads build its signature and callable. */
+    EVENTLISTENER_API int AddEventListener(void *objAddress, EventId eventId, const void *signature, ListenerFunction fn, int priority);
+
+    /*
+     * Calls `*pfn` without taking ownership of it: the caller keeps it alive for as long as the listener exists
+     * and deletes it, if needed, after deleting the listener. Listeners with a higher `priority` run first;
+     * listeners with equal priority run in the order they were created.
+     */
+    template <typename... arguments>
+    int CreateEventListener(void *objAddress, EventId eventId, EventFunction<arguments...> *pfn, int priority = 0)
+    {
+        return AddEventListener(objAddress, eventId, SignatureOf<arguments...>(), MakeListenerFunction<arguments...>([pfn](const SEvent &event, const auto &...args)
+            {
+                (*pfn)(event, args...);
+            }), priority);
+    }
+
+    template <typename... arguments>
+    int CreateEventListener(void *objAddress, const char *eventName, EventFunction<arguments...> *pfn, int priority = 0)
+    {
+        return CreateEventListener(objAddress, RegisterEventName(eventName), pfn, priority);
+    }
+
+    /*
+     * Stores a copy of `fn` (a lambda, functor, function pointer or EventFunction taking SEvent first) inline in
+     * the listener record. The argument types are deduced from its call operator.
+     */
+    template <typename F, typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<F>> || std::is_function_v<std::remove_pointer_t<std::decay_t<F>>>>>
+    int CreateEventListener(void *objAddress, EventId eventId, F &&fn, int priority = 0)
+    {
+        using Traits = SListenerTraits<std::decay_t<F>>;
+        return AddEventListener(objAddress, eventId, Traits::Signature(), Traits::Make(std::forward<F>(fn)), priority);
+    }
+
+    template <typename F, typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<F>> || std::is_function_v<std::remove_pointer_t<std::decay_t<F>>>>>
+    int CreateEventListener(void *objAddress, const char *eventName, F &&fn, int priority = 0)
+    {
+        return CreateEventListener(objAddress, RegisterEventName(eventName), std::forward<F>(fn), priority);
+    }
+
+    template <typename F, typename = std::enable_if_t<!std::is_pointer_v<std::decay_t<F>> || std::is_function_v<std::remove_pointer_t<std::decay_t<F>>>>>
+    int CreateEventListener(void *objAddress, const EventName &eventName, F &&fn, int priority = 0)
+    {
+        return CreateEventListener(objAddress, RegisterEventName(eventName), std::forward<F>(fn), priority);
+    }
+
+    EVENTLISTENER_API int DeleteEventListener(int id);
+
+    /* Deletes every listener in `ids`, taking each affected shard's lock once and compacting each affected event once. */
+    EVENTLISTENER_API int DeleteEventListeners(Span<const int> ids);
+
+    EVENTLISTENER_API int DeleteEventListeners(void *objAddress);
+
+    EVENTLISTENER_API int DeleteEventListeners(EventId eventId);
+
+    EVENTLISTENER_API int DeleteEventListeners(const char *eventName);
+
+    EVENTLISTENER_API int DeleteEventListeners(const EventName &eventName);
+
+    /*
+     * Owns one listener registration and deletes the listener (and with it the callable) when destroyed.
+     * Subscriptions can be moved but not copied; Release() gives up ownership without deleting the listener.
+     */
+    class Subscription
+    {
+    public:
+        using Unsubscriber = int (*)(void *owner, int id);
+
+        Subscription() noexcept = default;
+        Subscription(Unsubscriber unsubscribe, void *owner, int id) noexcept : m_unsubscribe(unsubscribe), m_owner(owner), m_id(id) {}
+        Subscription(Subscription &&other) noexcept { *this = std::move(other); }
+        Subscription(const Subscription &) = delete;
+        Subscription &operator=(const Subscription &) = delete;
+        ~Subscription() { Unsubscribe(); }
+
+        Subscription &operator=(Subscription &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Unsubscribe();
+                m_unsubscribe = other.m_unsubscribe;
+                m_owner = other.m_owner;
+                m_id = other.m_id;
+                other.m_unsubscribe = nullptr;
+            }
+            return *this;
+        }
+
+        /* Deletes the listener now. Returns how many listeners were deleted (0 if it was already gone). */
+        int Unsubscribe() noexcept
+        {
+            Unsubscriber unsubscribe = m_unsubscribe;
+            m_unsubscribe = nullptr;
+            return unsubscribe ? unsubscribe(m_owner, m_id) : 0;
+        }
+
+        /* Stops managing the listener and returns its ID. */
+        int Release() noexcept
+        {
+            m_unsubscribe = nullptr;
+            return m_id;
+        }
+
+        int Id() const noexcept { return m_id; }
+        explicit operator bool() const noexcept { return m_unsubscribe != nullptr; }
+
+    private:
+        Unsubscriber m_unsubscribe = nullptr;
+        void *m_owner = nullptr;
+        int m_id = 0;
+    };
+
+    /* Same as CreateEventListener, but the listener is deleted when the returned Subscription is destroyed. Returns an empty Subscription if it could not be created. */
+    template <typename F>
+    Subscription Subscribe(void *objAddress, EventId eventId, F &&fn, int priority = 0)
+    {
+        int id = CreateEventListener(objAddress, eventId, std::forward<F>(fn), priority);
+        if (id == 0)
+            return Subscription();
+        return Subscription([](void *, int id) -> int { return DeleteEventListener(id); }, nullptr, id);
+    }
+
+    template <typename F>
+    Subscription Subscribe(void *objAddress, const char *eventName, F &&fn, int priority = 0)
+    {
+        return Subscribe(objAddress, RegisterEventName(eventName), std::forward<F>(fn), priority);
+    }
+
+    template <typename F>
+    Subscription Subscribe(void *objAddress, const EventName &eventName, F &&fn, int priority = 0)
+    {
+        return Subscribe(objAddress, RegisterEventName(eventName), std::forward<F>(fn), priority);
+    }
+
+    /* Calls each listener in `listeners`, handing every one of them references to the same argument values. */
+    template <typename... arguments>
+    int CallEvents(const std::vector<const SListener *> &listeners, const arguments &...args)
+    {
+        int count = 0;
+        const void *const argv[sizeof...(arguments) + 1] = {&args...};
+        for (const SListener *listener : listeners)
+        {
+            EVENTLISTENER_TRACE("Calling listener function.");
+            if (CallEvent(*listener, SignatureOf<arguments...>(), argv))
+                ++count;
+        }
+        return count;
+    }
+
+    template <typename... Args>
+    int PushEvent(EventId eventId, Args &&...args)
+    {
+        EVENTLISTENER_PROBE2(push__entry, (std::uint64_t)eventId, (std::uintptr_t)0);
+        EVENTLISTENER_TRACE("Looking up event.");
+        const SListenerSnapshot snapshot(eventId, [&eventId](const SEventTable &events)
+            {
+                return FindListeners(events, eventId);
+            });
+        const int count = snapshot.listeners ? CallEvents<std::decay_t<Args>...>(*snapshot.listeners, args...) : 0;
+        EVENTLISTENER_PROBE3(push__return, (std::uint64_t)eventId, (std::uintptr_t)0, count);
+        return count;
+    }
+
+    template <typename... Args>
+    int PushEvent(void *objAddress, EventId eventId, Args &&...args)
+    {
+        EVENTLISTENER_PROBE2(push__entry, (std::uint64_t)eventId, (std::uintptr_t)objAddress);
+        EVENTLISTENER_TRACE("Looking up event.");
+        const SListenerSnapshot snapshot(eventId, [&objAddress, &eventId](const SEventTable &events)
+            {
+                return FindListeners(events, objAddress, eventId);
+            });
+        const int count = snapshot.listeners ? CallEvents<std::decay_t<Args>...>(*snapshot.listeners, args...) : 0;
+        EVENTLISTENER_PROBE3(push__return, (std::uint64_t)eventId, (std::uintptr_t)objAddress, count);
+        return count;
+    }
+
+    template <typename... Args>
+    int PushEvent(const char *eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEvent(eventId, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    int PushEvent(void *objAddress, const char *eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEvent(objAddress, eventId, std::forward<Args>(args)...);
+    }
+
+    /* Looks the event up by its precomputed hash instead of hashing the name (see LookupEventName). */
+    template <typename... Args>
+    int PushEvent(const EventName &eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEvent(eventId, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    int PushEvent(void *objAddress, const EventName &eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEvent(objAddress, eventId, std::forward<Args>(args)...);
+    }
+
+    /*
+     * PushEvent<"Name"_evt>(args...): the name hash is a template argument, so the event is resolved once per
+     * call site and cached; no name is hashed, compared or looked up on later pushes.
+     */
+    template <std::uint64_t Hash, typename... Args>
+    int PushEvent(Args &&...args)
+    {
+        EventId eventId = StaticEventId<Hash>();
+        return eventId == EventId::Invalid ? 0 : PushEvent(eventId, std::forward<Args>(args)...);
+    }
+
+    /* A read-only Span over any contiguous container (or Span) of payloads. */
+    template <typename Payloads>
+    auto MakeBatch(const Payloads &payloads)
+    {
+        using Payload = std::remove_cv_t<std::remove_pointer_t<decltype(std::data(payloads))>>;
+        return Span<const Payload>(std::data(payloads), std::size(payloads));
+    }
+
+    /*
+     * Hands a whole batch to each listener: listeners taking Span<const Payload> get it in a single call,
+     * listeners taking one Payload are called once per element. Returns how many listeners were reached.
+     */
+    template <typename Payload>
+    int CallEventsBatch(const std::vector<const SListener *> &listeners, Span<const Payload> batch)
+    {
+        int count = 0;
+        const void *const batchSignature = SignatureOf<Span<const Payload>>();
+        const void *const itemSignature = SignatureOf<Payload>();
+        const void *const batchArgv[] = {&batch};
+        for (const SListener *listener : listeners)
+        {
+            if (listener->removed.load(std::memory_order_relaxed))
+                continue;
+            if (listener->signature == batchSignature)
+            {
+                EVENTLISTENER_TRACE("Calling batch listener function.");
+                count += CallEvent(*listener, batchSignature, batchArgv);
+                continue;
+            }
+            if (listener->signature != itemSignature)
+            {
+                EVENTLISTENER_WARN("Listener arguments do not match the pushed event.");
+                continue;
+            }
+            bool called = false;
+            for (const Payload &payload : batch)
+            {
+                const void *const argv[] = {&payload};
+                called |= CallEvent(*listener, itemSignature, argv);
+            }
+            count += called;
+        }
+        return count;
+    }
+
+    /*
+     * Pushes every element of `payloads` (a contiguous container or Span) as one event, finding the listeners
+     * once for the whole batch instead of once per element.
+     */
+    template <typename Payloads>
+    int PushEventBatch(EventId eventId, const Payloads &payloads)
+    {
+        EVENTLISTENER_PROBE2(push__entry, (std::uint64_t)eventId, (std::uintptr_t)0);
+        EVENTLISTENER_TRACE("Looking up event.");
+        const SListenerSnapshot snapshot(eventId, [&eventId](const SEventTable &events)
+            {
+                return FindListeners(events, eventId);
+            });
+        const int count = snapshot.listeners ? CallEventsBatch(*snapshot.listeners, MakeBatch(payloads)) : 0;
+        EVENTLISTENER_PROBE3(push__return, (std::uint64_t)eventId, (std::uintptr_t)0, count);
+        return count;
+    }
+
+    template <typename Payloads>
+    int PushEventBatch(void *objAddress, EventId eventId, const Payloads &payloads)
+    {
+        EVENTLISTENER_PROBE2(push__entry, (std::uint64_t)eventId, (std::uintptr_t)objAddress);
+        EVENTLISTENER_TRACE("Looking up event.");
+        const SListenerSnapshot snapshot(eventId, [&objAddress, &eventId](const SEventTable &events)
+            {
+                return FindListeners(events, objAddress, eventId);
+            });
+        const int count = snapshot.listeners ? CallEventsBatch(*snapshot.listeners, MakeBatch(payloads)) : 0;
+        EVENTLISTENER_PROBE3(push__return, (std::uint64_t)eventId, (std::uintptr_t)objAddress, count);
+        return count;
+    }
+
+    template <typename Payloads>
+    int PushEventBatch(const char *eventName, const Payloads &payloads)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEventBatch(eventId, payloads);
+    }
+
+    template <typename Payloads>
+    int PushEventBatch(void *objAddress, const char *eventName, const Payloads &payloads)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEventBatch(objAddress, eventId, payloads);
+    }
+
+    template <typename Payloads>
+    int PushEventBatch(const EventName &eventName, const Payloads &payloads)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEventBatch(eventId, payloads);
+    }
+
+    template <typename Payloads>
+    int PushEventBatch(void *objAddress, const EventName &eventName, const Payloads &payloads)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : PushEventBatch(objAddress, eventId, payloads);
+    }
+
+    /*
+     * A typed event channel. Listeners and pushes are checked against Args at compile time, and listeners are
+     * stored inline with no name lookup and no signature check at runtime. Each call still goes through the
+     * InplaceFunction's function pointer, so it cannot be inlined; StaticDispatcher can, for fixed listeners.
+     */
+    template <typename... Args>
+    class Event
+    {
+    public:
+        Event() = default;
+        explicit Event(std::string_view name) : m_event(RegisterEventName(name)), m_name(GetEventName(m_event)) {}
+        Event(const Event &) = delete;
+        Event &operator=(const Event &) = delete;
+
+        template <typename F>
+        int Listen(F &&fn)
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto listeners = std::make_shared<std::vector<SEntry>>(*m_listeners);
+            listeners->push_back(SEntry{m_nextId, std::forward<F>(fn)});
+            m_listeners = std::move(listeners);
+            return m_nextId++;
+        }
+
+        int Unlisten(int id)
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto listeners = std::make_shared<std::vector<SEntry>>();
+            for (const SEntry &entry : *m_listeners)
+                if (entry.id != id)
+                    listeners->push_back(entry);
+            int count = (int)(m_listeners->size() - listeners->size());
+            m_listeners = std::move(listeners);
+            return count;
+        }
+
+        /*
+         * Calls every listener without holding the channel's lock, so listeners may use the channel themselves.
+         * Every listener sees the same arguments; only listeners taking one by value copy it.
+         */
+        int Push(ParameterOf<Args>...args) const
+        {
+            std::shared_ptr<const std::vector<SEntry>> listeners;
+            {
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                listeners = m_listeners;
+            }
+            for (const SEntry &entry : *listeners)
+            {
+                try
+                {
+                    entry.fn(SEvent{entry.id, (uintptr_t)this, m_name, m_event}, args...);
+                } catch (std::exception &e) {
+                    EVENTLISTENER_WARN("Listener event threw an exception.");
+                }
+            }
+            return (int)listeners->size();
+        }
+
+        int operator()(ParameterOf<Args>...args) const { return Push(std::forward<ParameterOf<Args>>(args)...); }
+
+        /* Same as Listen, but the listener is removed when the returned Subscription is destroyed. The channel must outlive it. */
+        template <typename F>
+        Subscription Subscribe(F &&fn)
+        {
+            int id = Listen(std::forward<F>(fn));
+            return Subscription([](void *owner, int id) -> int { return static_cast<Event *>(owner)->Unlisten(id); }, this, id);
+        }
+
+    private:
+        struct SEntry
+        {
+            int id;
+            InplaceFunction<void(SEvent, Args...)> fn;
+        };
+
+        mutable std::mutex m_mutex;
+        std::shared_ptr<const std::vector<SEntry>> m_listeners = std::make_shared<const std::vector<SEntry>>();
+        EventId m_event = EventId::Invalid;
+        std::string_view m_name;
+        int m_nextId = 0;
+    };
+
+    /*
+     * Listeners wired at compile time. StaticDispatcher<Tag, &OnA, &OnB>::Push(args...) calls OnA and OnB
+     * directly, in order, with no registry lookup, no locking and no type erasure, so the calls can be inlined.
+     * Listeners may take SEvent first like any other listener, or only the pushed arguments. `Event` is a tag
+     * type that names the event and keeps dispatchers with the same listeners apart.
+     */
+    template <typename Event, auto... Listeners>
+    struct StaticDispatcher
+    {
+        template <typename... Args>
+        static int Push(const Args &...args)
+        {
+            (Call<Listeners>(args...), ...);
+            return (int)sizeof...(Listeners);
+        }
+
+        template <typename... Args>
+        int operator()(const Args &...args) const { return Push(args...); }
+
+    private:
+        template <auto Listener, typename... Args>
+        static void Call(const Args &...args)
+        {
+            try
+            {
+                if constexpr (std::is_invocable_v<decltype(Listener), const SEvent &, const Args &...>)
+                    std::invoke(Listener, SEvent{0, 0, {}, EventId::Invalid}, args...);
+                else
+                    std::invoke(Listener, args...);
+            } catch (std::exception &e) {
+                EVENTLISTENER_WARN("Listener event threw an exception.");
+            }
+        }
+    };
+
+    /*
+     * A base class (or member) that gives an object its own listener table. Listening and emitting on one
+     * emitter touch only that emitter's table and lock, never the global registry, and destroying the emitter
+     * drops its listeners. Listeners see the emitter's address in SEvent::address. Emitters can be neither
+     * copied nor moved, since Subscriptions hold that address.
+     */
+    class EventEmitter
+    {
+    public:
+        EventEmitter() = default;
+        EventEmitter(const EventEmitter &) = delete;
+        EventEmitter &operator=(const EventEmitter &) = delete;
+
+        /* Same rules as CreateEventListener; the ID is only meaningful to this emitter. */
+        template <typename F>
+        int Listen(EventId eventId, F &&fn)
+        {
+            using Traits = SListenerTraits<std::decay_t<F>>;
+            SEntry entry{0, eventId, GetEventName(eventId), Traits::Signature(), Traits::Make(std::forward<F>(fn))};
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto listeners = std::make_shared<std::vector<SEntry>>(*m_listeners);
+            entry.id = ++m_lastId;
+            listeners->push_back(std::move(entry));
+            m_listeners = std::move(listeners);
+            return m_lastId;
+        }
+
+        template <typename F>
+        int Listen(const char *eventName, F &&fn)
+        {
+            return Listen(RegisterEventName(eventName), std::forward<F>(fn));
+        }
+
+        int Unlisten(int id)
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto listeners = std::make_shared<std::vector<SEntry>>();
+            for (const SEntry &entry : *m_listeners)
+                if (entry.id != id)
+                    listeners->push_back(entry);
+            int count = (int)(m_listeners->size() - listeners->size());
+            m_listeners = std::move(listeners);
+            return count;
+        }
+
+        /* Removes every listener of this emitter, or only those of one event. */
+        int UnlistenAll(EventId eventId = EventId::Invalid)
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            auto listeners = std::make_shared<std::vector<SEntry>>();
+            if (eventId != EventId::Invalid)
+                for (const SEntry &entry : *m_listeners)
+                    if (entry.event != eventId)
+                        listeners->push_back(entry);
+            int count = (int)(m_listeners->size() - listeners->size());
+            m_listeners = std::move(listeners);
+            return count;
+        }
+
+        /* Calls this emitter's listeners of `eventId` without holding its lock; returns how many were called. */
+        template <typename... Args>
+        int Emit(EventId eventId, Args &&...args) const
+        {
+            return EmitArgs<std::decay_t<Args>...>(eventId, args...);
+        }
+
+        template <typename... Args>
+        int Emit(const char *eventName, Args &&...args) const
+        {
+            EventId eventId = LookupEventName(eventName);
+            return eventId == EventId::Invalid ? 0 : Emit(eventId, std::forward<Args>(args)...);
+        }
+
+        /* Same as Listen, but the listener is removed when the returned Subscription is destroyed. The emitter must outlive it. */
+        template <typename F>
+        Subscription Subscribe(EventId eventId, F &&fn)
+        {
+            int id = Listen(eventId, std::forward<F>(fn));
+            return Subscription([](void *owner, int id) -> int { return static_cast<EventEmitter *>(owner)->Unlisten(id); }, this, id);
+        }
+
+        template <typename F>
+        Subscription Subscribe(const char *eventName, F &&fn)
+        {
+            return Subscribe(RegisterEventName(eventName), std::forward<F>(fn));
+        }
+
+    private:
+        /* Emit with the argument types decayed as they are for listeners, so the argument array matches the signature. */
+        template <typename... arguments>
+        int EmitArgs(EventId eventId, const arguments &...args) const
+        {
+            std::shared_ptr<const std::vector<SEntry>> listeners;
+            {
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                listeners = m_listeners;
+            }
+            int count = 0;
+            const void *const signature = SignatureOf<arguments...>();
+            const void *const argv[sizeof...(arguments) + 1] = {&args...};
+            for (const SEntry &entry : *listeners)
+            {
+                if (entry.event != eventId)
+                    continue;
+                if (entry.signature != signature)
+                {
+                    EVENTLISTENER_WARN("Listener arguments do not match the pushed event.");
+                    continue;
+                }
+                try
+                {
+                    entry.fn(SEvent{entry.id, (uintptr_t)this, entry.name, entry.event}, argv);
+                } catch (std::exception &e) {
+                    EVENTLISTENER_WARN("Listener event threw an exception.");
+                }
+                ++count;
+            }
+            return count;
+        }
+
+        struct SEntry
+        {
+            int id;
+            EventId event;
+            std::string_view name;
+            const void *signature;
+            ListenerFunction fn;
+        };
+
+        mutable std::mutex m_mutex;
+        std::shared_ptr<const std::vector<SEntry>> m_listeners = std::make_shared<const std::vector<SEntry>>();
+        int m_lastId = 0;
+    };
+
+    /*
+     * Bounded lock-free ring buffer (Vyukov's sequence-numbered array queue). Any number of threads may push;
+     * the dispatcher thread is the only regular consumer, though producers may also pop to drop old entries.
+     * Cells and both cursors sit on their own cache lines so producers and the consumer do not false-share.
+     */
+    template <typename T>
+    struct SRingBuffer
+    {
+        struct alignas(64) SCell
+        {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        alignas(64) std::atomic<std::size_t> enqueuePos{0};
+        alignas(64) std::atomic<std::size_t> dequeuePos{0};
+        std::size_t mask;
+        std::unique_ptr<SCell[]> cells;
+
+        explicit SRingBuffer(std::size_t capacity)
+        {
+            std::size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            mask = size - 1;
+            cells.reset(new SCell[size]);
+            for (std::size_t i = 0; i < size; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        /* Moves from `value` only when it succeeds. */
+        bool TryPush(T &value)
+        {
+            std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                SCell &cell = cells[pos & mask];
+                std::intptr_t diff = (std::intptr_t)cell.sequence.load(std::memory_order_acquire) - (std::intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        // seq_cst pairs with the consumer's `sleeping` flag; see PushTask.
+                        cell.sequence.store(pos + 1);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        bool TryPop(T &value)
+        {
+            std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                SCell &cell = cells[pos & mask];
+                std::intptr_t diff = (std::intptr_t)cell.sequence.load(std::memory_order_acquire) - (std::intptr_t)(pos + 1);
+                if (diff == 0)
+                {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        value = std::move(cell.value);
+                        cell.value = T();
+                        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        bool Empty() const
+        {
+            std::size_t pos = dequeuePos.load();
+            return (std::intptr_t)cells[pos & mask].sequence.load() - (std::intptr_t)(pos + 1) < 0;
+        }
+    };
+
+    /* What a bounded dispatcher queue does with an event when it is full. */
+    enum class EBackpressure
+    {
+        Block,      // the pushing thread waits for room; a dispatcher thread runs the event inline instead
+        DropNewest, // the new event is discarded
+        DropOldest  // the oldest queued event is discarded to make room
+    };
+
+    struct SDispatcherOptions
+    {
+        std::size_t threads = std::thread::hardware_concurrency();
+        std::size_t capacity = 0; // events per dispatcher thread; 0 uses an unbounded, mutex-protected queue
+        EBackpressure backpressure = EBackpressure::Block;
+    };
+
+    struct SDispatcherStats
+    {
+        std::uint64_t pushed;
+        std::uint64_t dispatched;
+        std::uint64_t dropped;
+    };
+
+    /*
+     * Asynchronous dispatch. Each dispatcher thread owns one queue; an event goes to the queue picked by its
+     * (object address, event) pair, so events pushed for the same pair run in the order they were pushed.
+     * Events for different pairs may run concurrently and in any order.
+     */
+    /* A queued asynchronous event. Small payloads are stored inline so queueing them does not allocate. */
+    using EventTask = InplaceFunction<void()>;
+
+    /* Falls back to one shared allocation for tasks too large to store inline. */
+    template <typename F>
+    EventTask MakeEventTask(F &&fn)
+    {
+        using T = std::decay_t<F>;
+        if constexpr (sizeof(T) <= EVENTLISTENER_INPLACE_SIZE && alignof(T) <= alignof(std::max_align_t))
+            return EventTask(std::forward<F>(fn));
+        else
+            return EventTask([target = std::make_shared<T>(std::forward<F>(fn))]() { (*target)(); });
+    }
+
+    struct SDispatchQueue
+    {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable drained;
+        std::condition_variable room;
+        std::deque<EventTask> tasks;
+        std::unique_ptr<SRingBuffer<EventTask>> ring;
+        EBackpressure backpressure = EBackpressure::Block;
+        std::atomic<std::uint64_t> pushed{0};
+        std::atomic<std::uint64_t> completed{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<int> flushing{0};
+        std::atomic<int> blocked{0};
+        std::atomic<bool> sleeping{false};
+        bool stopping = false;
+    };
+
+    inline std::vector<std::unique_ptr<SDispatchQueue>> g_dispatch_queues{};
+    inline thread_local SDispatchQueue *t_dispatch_queue = nullptr;
+    inline std::vector<std::thread> g_dispatch_threads{};
+    inline std::shared_mutex g_dispatcher_mutex;
+
+    /* Stops the dispatcher threads after they have run every queued event. */
+    EVENTLISTENER_API void StopEventDispatcher();
+
+    /* Drains and joins the dispatcher threads at exit, before the queues they use are destroyed. */
+    struct SDispatcherShutdown
+    {
+        ~SDispatcherShutdown() { StopEventDispatcher(); }
+    };
+
+    inline SDispatcherShutdown g_dispatcher_shutdown;
+
+    /* Starts the dispatcher threads, replacing (and draining) any that are already running. */
+    EVENTLISTENER_API void StartEventDispatcher(const SDispatcherOptions &options);
+
+    EVENTLISTENER_API void StartEventDispatcher(std::size_t threads = std::thread::hardware_concurrency());
+
+    /* Blocks until every event pushed asynchronously before the call has been dispatched or dropped. Do not call it from a listener. */
+    EVENTLISTENER_API void FlushEvents();
+
+    /* Totals for the running dispatcher; they restart from zero with StartEventDispatcher. */
+    EVENTLISTENER_API SDispatcherStats GetDispatcherStats();
+
+    /* Queues `task` on the dispatcher thread owning (objAddress, eventId), starting the dispatcher if needed. */
+    EVENTLISTENER_API bool EnqueueEvent(void *objAddress, EventId eventId, EventTask task);
+
+    template <typename... Args>
+    bool PushEventAsync(EventId eventId, Args &&...args)
+    {
+        return EnqueueEvent(nullptr, eventId, MakeEventTask([eventId, payload = std::make_tuple(std::forward<Args>(args)...)]() mutable
+            {
+                std::apply([&eventId](auto &...args) { PushEvent(eventId, args...); }, payload);
+            }));
+    }
+
+    template <typename... Args>
+    bool PushEventAsync(void *objAddress, EventId eventId, Args &&...args)
+    {
+        return EnqueueEvent(objAddress, eventId, MakeEventTask([objAddress, eventId, payload = std::make_tuple(std::forward<Args>(args)...)]() mutable
+            {
+                std::apply([&objAddress, &eventId](auto &...args) { PushEvent(objAddress, eventId, args...); }, payload);
+            }));
+    }
+
+    template <typename... Args>
+    bool PushEventAsync(const char *eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId != EventId::Invalid && PushEventAsync(eventId, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool PushEventAsync(void *objAddress, const char *eventName, Args &&...args)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId != EventId::Invalid && PushEventAsync(objAddress, eventId, std::forward<Args>(args)...);
+    }
 }
-void EventListenerError(const char* text)
+
+#if !defined(EVENTLISTENER_SEPARATE_COMPILATION) || defined(EVENTLISTENER_IMPLEMENTATION)
+/* Non-template definitions, compiled once when EVENTLISTENER_SEPARATE_COMPILATION is defined */
+namespace EventListener
 {
-    std::cerr << text << std::endl;
-}
+    EVENTLISTENER_API void WriteLogLine(ELogLevel level, const char *text)
+    {
+        static const char *const prefixes[] = {"", "ERROR: ", "WARNING: ", "", ""};
+        std::fprintf(stderr, "[EventListener] %s%s\n", prefixes[(int)level], text);
+    }
+
+    EVENTLISTENER_API void WriteLog(ELogLevel level, const char *text)
+    {
+        if (g_async_log.running.load(std::memory_order_relaxed))
+        {
+            std::unique_lock<std::mutex> lock(g_async_log.mutex);
+            if (g_async_log.running.load(std::memory_order_relaxed))
+            {
+                bool wasEmpty = g_async_log.pending.empty();
+                g_async_log.pending.emplace_back(level, text);
+                lock.unlock();
+                if (wasEmpty)
+                    g_async_log.wake.notify_one();
+                return;
+            }
+        }
+        g_log_sink.load(std::memory_order_acquire)(level, text);
+    }
+
+    EVENTLISTENER_API void SetLogSink(LogSink sink)
+    {
+        g_log_sink.store(sink ? sink : &WriteLogLine, std::memory_order_release);
+    }
+
+    EVENTLISTENER_API void StartAsyncLogging()
+    {
+        g_async_log.Start();
+    }
+
+    EVENTLISTENER_API void StopAsyncLogging()
+    {
+        g_async_log.Stop();
+    }
+
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+    /* Publishes a copy of the name maps and frees the replaced copies no thread is reading. Caller holds g_event_names_mutex exclusively. */
+    EVENTLISTENER_API void PublishEventNames()
+    {
+        SEventNameTables &tables = g_event_name_tables;
+        const std::uint64_t birth = g_epoch.load();
+        const SEventNameTable *old = tables.current.exchange(new SEventNameTable{g_event_ids, g_event_hashes});
+        tables.retired.push_back(SRetiredTable<SEventNameTable>{old, tables.birth, g_epoch.fetch_add(1)});
+        tables.birth = birth;
+        ReclaimRetiredTables(tables.retired);
+    }
+
+    EVENTLISTENER_API EventId LookupEventName(std::string_view name)
+    {
+        const SReadSection section;
+        const SEventNameTable *table = g_event_name_tables.current.load();
+        if (table == nullptr)
+            return EventId::Invalid;
+        auto found = table->ids.find(name);
+        return found == table->ids.end() ? EventId::Invalid : found->second;
+    }
 #else
-void EventListenerLog(const char* text) {}
-void EventListenerError(const char* text) {}
+    EVENTLISTENER_API EventId LookupEventName(std::string_view name)
+    {
+        const std::shared_lock<std::shared_mutex> lock(g_event_names_mutex);
+        auto found = g_event_ids.find(name);
+        return found == g_event_ids.end() ? EventId::Invalid : found->second;
+    }
 #endif
 
-namespace EventListener
-{
-    struct SEvent
+    EVENTLISTENER_API EventId RegisterEventName(std::string_view name)
     {
-        int id;
-        uintptr_t address;
-        std::string name;
-    };
+        EventId id = LookupEventName(name);
+        if (id != EventId::Invalid)
+            return id;
+        const std::lock_guard<std::shared_mutex> lock(g_event_names_mutex);
+        auto found = g_event_ids.find(name);
+        if (found != g_event_ids.end())
+            return found->second;
+        EVENTLISTENER_DEBUG("Registering event name.");
+        g_event_names.emplace_back(name);
+        id = static_cast<EventId>(g_event_names.size());
+        g_event_ids.emplace(g_event_names.back(), id);
+        if (!g_event_hashes.emplace(HashEventName(name), SEventHash{id, g_event_names.back()}).second)
+            EVENTLISTENER_WARN("Event name hash collides with another name; PushEvent<Hash> cannot reach it.");
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        PublishEventNames();
+#endif
+        return id;
+    }
 
-    template <typename... arguments>
-    using EventFunction = std::function<void(SEvent, arguments...)>;
+    EVENTLISTENER_API EventId RegisterEventName(const EventName &name)
+    {
+        EventId id = LookupEventName(name);
+        return id != EventId::Invalid ? id : RegisterEventName(name.name);
+    }
 
-    struct SListener
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+    /* Returns the entry for this hash, or nullptr. Caller is inside a read section. */
+    EVENTLISTENER_API const SEventHash *FindEventHash(std::uint64_t hash)
     {
-        int id;
-        void *address;
-        const char *name;
-        void **fn;
-    };
+        const SEventNameTable *table = g_event_name_tables.current.load();
+        if (table == nullptr)
+            return nullptr;
+        auto found = table->hashes.find(hash);
+        return found == table->hashes.end() ? nullptr : &found->second;
+    }
+
+    EVENTLISTENER_API EventId LookupEventHash(std::uint64_t hash)
+    {
+        const SReadSection section;
+        const SEventHash *found = FindEventHash(hash);
+        return found == nullptr ? EventId::Invalid : found->id;
+    }
 
-    std::vector<SListener> g_events{};
-    std::mutex g_events_mutex;
+    EVENTLISTENER_API EventId LookupEventName(const EventName &eventName)
+    {
+        {
+            const SReadSection section;
+            const SEventHash *found = FindEventHash(eventName.hash);
+            if (found == nullptr)
+                return EventId::Invalid;
+            if (found->name == eventName.name)
+                return found->id;
+        }
+        // Another name has this hash; this one, if registered at all, is only found by name.
+        return LookupEventName(eventName.name);
+    }
+#else
+    /* Returns the entry for this hash, or nullptr. Caller holds g_event_names_mutex. */
+    EVENTLISTENER_API const SEventHash *FindEventHash(std::uint64_t hash)
+    {
+        auto found = g_event_hashes.find(hash);
+        return found == g_event_hashes.end() ? nullptr : &found->second;
+    }
 
-    template<class T>
-    void filterVec(std::vector<T>& vec, std::function<bool(T&)> f)
+    EVENTLISTENER_API EventId LookupEventHash(std::uint64_t hash)
     {
-        std::vector<T> _vec = {};
-        for(auto& item : vec)
-            if(f(item)) _vec.push_back(item);
-        vec = _vec;
+        const std::shared_lock<std::shared_mutex> lock(g_event_names_mutex);
+        const SEventHash *found = FindEventHash(hash);
+        return found == nullptr ? EventId::Invalid : found->id;
     }
 
-    template <typename... arguments>
-    void CallEvent(void *objAddress, const char *eventName, arguments... args)
+    EVENTLISTENER_API EventId LookupEventName(const EventName &eventName)
     {
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Calling listener event.");
-        for (auto &event : g_events)
         {
-            if (event.address == objAddress && eventName)
-                try
-                {
-                    (*(EventFunction<arguments...> *)event.fn)(SEvent{event.id, (uintptr_t)objAddress, std::string(eventName)}, args...);
-                    EventListenerLog("Successfully called listener event.");
-                } catch (std::exception &e) {
-                    EventListenerError("WARNING: Listener event threw an exception.");
-                }
+            const std::shared_lock<std::shared_mutex> lock(g_event_names_mutex);
+            const SEventHash *found = FindEventHash(eventName.hash);
+            if (found == nullptr)
+                return EventId::Invalid;
+            if (found->name == eventName.name)
+                return found->id;
         }
+        // Another name has this hash; this one, if registered at all, is only found by name.
+        return LookupEventName(eventName.name);
     }
+#endif
 
-    template <typename... arguments>
-    void CreateEventListener(void *objAddress, const char *eventName, EventFunction<arguments...> *pfn)
+    EVENTLISTENER_API std::string_view GetEventName(EventId id)
     {
-        static int id = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Creating listener.");
-        g_events.push_back(SListener{id++, objAddress, eventName, (void **)pfn});
-        EventListenerLog("Listener created.");
+        const std::shared_lock<std::shared_mutex> lock(g_event_names_mutex);
+        if (id == EventId::Invalid || static_cast<std::size_t>(id) > g_event_names.size())
+            return {};
+        return g_event_names[static_cast<std::size_t>(id) - 1];
     }
 
-    int DeleteEventListener(int id)
+    /*
+     * Reserves a slot of the shard and returns its index, or kSlotIndexMask + 1 if every slot is taken. Takes
+     * the oldest free slot once kFreeSlotReserve are queued, and carves a new one otherwise while there are
+     * any left. Caller holds the shard's lock.
+     */
+    EVENTLISTENER_API std::uint32_t AcquireListenerSlot(SEventShard &shard)
     {
-        int count = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Scanning listeners.");
-        filterVec<SListener>(g_events, [&count, &id](SListener &listener) -> bool
+        if (shard.slabUsed == kSlabSize && shard.freeSlots.size() <= kFreeSlotReserve && g_listener_slabs.count.load(std::memory_order_relaxed) < kSlabCount)
+        {
+            std::uint32_t slab = g_listener_slabs.count.fetch_add(1, std::memory_order_relaxed);
+            if (slab < kSlabCount)
             {
-                EventListenerLog("Checking listener.");
-                if (listener.id == id)
-                {
-                    EventListenerLog("Deleting listener.");
-                    ++count;
-                    return false;
-                }
-                else
-                    return true;
+                SListenerSlab *slots = new SListenerSlab();
+                slots->shard = (std::size_t)(&shard - g_shards);
+                g_listener_slabs.slabs[slab].store(slots, std::memory_order_release);
+                shard.slab = slab;
+                shard.slabUsed = 0;
+            }
+        }
+        if (shard.slabUsed < kSlabSize && shard.freeSlots.size() <= kFreeSlotReserve)
+            return shard.slab * kSlabSize + shard.slabUsed++;
+        if (shard.freeSlots.empty())
+            return kSlotIndexMask + 1;
+        std::uint32_t index = shard.freeSlots.front();
+        shard.freeSlots.pop_front();
+        return index;
+    }
+
+    EVENTLISTENER_API void SetListenerSampling(std::uint32_t period)
+    {
+        g_listener_sampling.store(period, std::memory_order_relaxed);
+    }
+
+    EVENTLISTENER_API std::vector<SListenerStats> GetListenerStats()
+    {
+        std::vector<SListenerStats> stats;
+        std::uint32_t slabs = std::min(g_listener_slabs.count.load(), kSlabCount);
+        for (std::uint32_t slab = 0; slab < slabs; ++slab)
+        {
+            const SListenerSlab *slots = g_listener_slabs.slabs[slab].load(std::memory_order_acquire);
+            if (slots == nullptr)
+                continue;
+            const SShardLock lock(g_shards[slots->shard]);
+            for (const SListenerSlot &slot : slots->slots)
+            {
+                const std::optional<SListener> &listener = slot.listener;
+                if (!listener || listener->removed.load(std::memory_order_relaxed))
+                    continue;
+                const SListenerCounters &counters = listener->counters;
+                SListenerStats &entry = stats.emplace_back();
+                entry.id = listener->id;
+                entry.event = listener->event;
+                entry.name = listener->name;
+                entry.calls = counters.calls.load(std::memory_order_relaxed);
+                entry.exceptions = counters.exceptions.load(std::memory_order_relaxed);
+                entry.sampled = counters.sampled.load(std::memory_order_relaxed);
+                entry.totalNanoseconds = counters.totalNanoseconds.load(std::memory_order_relaxed);
+                if (const std::atomic<std::uint64_t> *latency = counters.latency.load(std::memory_order_acquire))
+                    for (std::size_t bucket = 0; bucket < SLatencyHistogram::kBuckets; ++bucket)
+                        entry.latency.counts[bucket] = latency[bucket].load(std::memory_order_relaxed);
+            }
+        }
+        return stats;
+    }
+
+    EVENTLISTENER_API void RecordListenerLatency(const SListener &listener, std::chrono::steady_clock::time_point start)
+    {
+        const std::uint64_t nanoseconds = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        SListenerCounters &counters = listener.counters;
+        std::atomic<std::uint64_t> *latency = counters.latency.load(std::memory_order_acquire);
+        if (latency == nullptr)
+        {
+            std::atomic<std::uint64_t> *fresh = new std::atomic<std::uint64_t>[SLatencyHistogram::kBuckets]();
+            if (counters.latency.compare_exchange_strong(latency, fresh, std::memory_order_acq_rel))
+                latency = fresh;
+            else
+                delete[] fresh;
+        }
+        latency[SLatencyHistogram::BucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        counters.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        counters.sampled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    EVENTLISTENER_API std::array<SShardStats, EVENTLISTENER_SHARDS> GetShardStats()
+    {
+        std::array<SShardStats, EVENTLISTENER_SHARDS> stats{};
+        for (std::size_t i = 0; i < EVENTLISTENER_SHARDS; ++i)
+            stats[i] = SShardStats{g_shards[i].acquisitions.load(std::memory_order_relaxed), g_shards[i].contentions.load(std::memory_order_relaxed)};
+        return stats;
+    }
+
+    EVENTLISTENER_API SReaderRecord *AcquireReaderRecord()
+    {
+        for (SReaderRecord *record = g_reader_records.load(); record != nullptr; record = record->next)
+        {
+            bool used = false;
+            if (!record->used.load(std::memory_order_relaxed) && record->used.compare_exchange_strong(used, true))
+                return record;
+        }
+        SReaderRecord *record = new SReaderRecord();
+        record->used.store(true, std::memory_order_relaxed);
+        record->next = g_reader_records.load();
+        while (!g_reader_records.compare_exchange_weak(record->next, record))
+            ;
+        return record;
+    }
+
+    EVENTLISTENER_API void ReleaseReaderRecord(SReaderRecord *record)
+    {
+        record->used.store(false, std::memory_order_release);
+    }
+
+    EVENTLISTENER_API bool MayBeInUse(std::uint64_t birth, std::uint64_t retired)
+    {
+        // `lower` is read first: a record seen idle there can only begin a section after the item was unlinked.
+        for (SReaderRecord *record = g_reader_records.load(); record != nullptr; record = record->next)
+            if (record->lower.load() <= retired && birth <= record->upper.load())
+                return true;
+        return false;
+    }
+
+    EVENTLISTENER_API void ReclaimRetired(SEventShard &shard)
+    {
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        ReclaimRetiredTables(shard.retired);
+#else
+        (void)shard;
+#endif
+        auto kept = shard.retiredSlots.begin();
+        for (const SRetiredSlot &retired : shard.retiredSlots)
+        {
+            if (MayBeInUse(retired.birth, retired.retired))
+            {
+                *kept++ = retired;
+                continue;
+            }
+            EVENTLISTENER_TRACE("Freeing retired listener.");
+            SListenerSlot &slot = SlotAt(retired.index);
+            slot.listener.reset();
+            shard.freeSlots.push_back(retired.index);
+        }
+        shard.retiredSlots.erase(kept, shard.retiredSlots.end());
+    }
+
+    /* Makes a listener's ID stale at once; its record is retired, and its slot freed, once the edit is published. Caller holds the shard's lock. */
+    EVENTLISTENER_API void RetireListener(int id)
+    {
+        SListenerSlot &slot = SlotAt((std::uint32_t)id & kSlotIndexMask);
+        slot.generation = slot.generation == kSlotGenerationMask ? 1 : slot.generation + 1;
+        t_unlinked_listeners.push_back(id);
+    }
+
+    /*
+     * The edit that unlinked these listeners is visible to every new read section by now, so the epoch taken
+     * here ends their lifetime; only sections that began at or before it may still hold them.
+     */
+    EVENTLISTENER_API void RetireUnlinked(SEventShard &shard)
+    {
+        if (t_unlinked_listeners.empty())
+            return;
+        const std::uint64_t retired = g_epoch.fetch_add(1);
+        for (int id : t_unlinked_listeners)
+        {
+            std::uint32_t index = (std::uint32_t)id & kSlotIndexMask;
+            shard.retiredSlots.push_back(SRetiredSlot{index, SlotAt(index).birth, retired});
+        }
+        t_unlinked_listeners.clear();
+    }
+
+    /*
+     * Keeps `listeners` sorted by descending priority, placing `listener` after every listener of the same
+     * priority so that equal priorities run in registration order. Dispatch then just walks the list.
+     */
+    EVENTLISTENER_API void InsertByPriority(std::vector<const SListener *> &listeners, const SListener *listener)
+    {
+        auto position = std::upper_bound(listeners.begin(), listeners.end(), listener, [](const SListener *a, const SListener *b) -> bool
+            {
+                return a->priority > b->priority;
             });
-        return count;
+        listeners.insert(position, listener);
     }
 
-    int DeleteEventListeners(void *objAddress)
+    EVENTLISTENER_API int AddEventListener(void *objAddress, EventId eventId, const void *signature, ListenerFunction fn, int priority)
     {
-        int count = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Scanning listeners.");
-        filterVec<SListener>(g_events, [&objAddress, &count](SListener &listener) -> bool
+        std::string_view name = GetEventName(eventId);
+        SEventShard &shard = ShardOf(eventId);
+        const SShardLock lock(shard);
+        EVENTLISTENER_DEBUG("Creating listener.");
+        const SListener *record;
+        for (bool reclaimed = false;; reclaimed = true)
+        {
+            std::uint32_t index = AcquireListenerSlot(shard);
+            if (index <= kSlotIndexMask)
             {
-                EventListenerLog("Checking listener.");
-                if (listener.address == objAddress)
-                {
-                    EventListenerLog("Deleting listener.");
-                    return false;
-                    ++count;
-                }
-                else
-                    return true;
+                SListenerSlot &slot = SlotAt(index);
+                int id = (int)((slot.generation << kSlotIndexBits) | index);
+                slot.birth = g_epoch.load();
+                record = &slot.listener.emplace(id, objAddress, eventId, name, signature, std::move(fn), priority);
+                break;
+            }
+            // Every slot is live or retired: free whatever retired slots no thread can still be reading, then retry once.
+            if (reclaimed)
+            {
+                EVENTLISTENER_ERROR("Too many listeners.");
+                return 0;
+            }
+            ReclaimRetired(shard);
+        }
+        ModifyEventTable(shard, [&record](SEventTable &events) -> int
+            {
+                SEventBucket &bucket = events[record->event];
+                InsertByPriority(bucket.listeners, record);
+                InsertByPriority(bucket.objects[record->address], record);
+                return 1;
+            });
+        EVENTLISTENER_DEBUG("Listener created.");
+        return record->id;
+    }
+
+    /* Flags a listener as removed so dispatch skips it. Caller holds the shard's lock. */
+    EVENTLISTENER_API void MarkRemoved(SEventBucket &bucket, const SListener *listener)
+    {
+        EVENTLISTENER_TRACE("Deleting listener.");
+        const_cast<SListener *>(listener)->removed.store(true, std::memory_order_relaxed);
+        ++bucket.removed;
+    }
+
+    /*
+     * Erases removed listeners from a bucket in place, and retires them, once they make up at least half of
+     * it, so each deletion costs O(1) amortized. Erases the bucket if nothing is left. Caller holds the lock.
+     */
+    EVENTLISTENER_API void CompactBucket(SEventTable &events, SEventTable::iterator bucket)
+    {
+        SEventBucket &lists = bucket->second;
+        if (lists.removed * 2 < lists.listeners.size())
+            return;
+        EVENTLISTENER_DEBUG("Compacting listeners.");
+        auto isRemoved = [](const SListener *listener) -> bool { return listener->removed.load(std::memory_order_relaxed); };
+        for (auto object = lists.objects.begin(); object != lists.objects.end();)
+        {
+            object->second.erase(std::remove_if(object->second.begin(), object->second.end(), isRemoved), object->second.end());
+            object = object->second.empty() ? lists.objects.erase(object) : std::next(object);
+        }
+        auto kept = lists.listeners.begin();
+        for (const SListener *listener : lists.listeners)
+        {
+            if (isRemoved(listener))
+                RetireListener(listener->id);
+            else
+                *kept++ = listener;
+        }
+        lists.listeners.erase(kept, lists.listeners.end());
+        lists.removed = 0;
+        if (lists.listeners.empty())
+            events.erase(bucket);
+    }
+
+    /* Returns the shard a listener's slot, and so the listener, belongs to, or nullptr for IDs no slot was ever issued for. */
+    EVENTLISTENER_API SEventShard *ShardOfListener(int id)
+    {
+        const SListenerSlab *slab = SlabOf(id);
+        return slab == nullptr ? nullptr : &g_shards[slab->shard];
+    }
+
+    /*
+     * Flags a live listener as removed and returns it, or returns nullptr for unknown, stale and already deleted
+     * IDs. Caller holds the lock of the listener's shard.
+     */
+    EVENTLISTENER_API const SListener *RemoveListener(SEventTable &events, int id)
+    {
+        const SListener *listener = FindListener(id);
+        if (listener == nullptr || listener->removed.load(std::memory_order_relaxed))
+            return nullptr;
+        MarkRemoved(events[listener->event], listener);
+        return listener;
+    }
+
+    EVENTLISTENER_API int DeleteEventListener(int id)
+    {
+        EVENTLISTENER_TRACE("Looking up listener.");
+        SEventShard *shard = ShardOfListener(id);
+        if (shard == nullptr)
+            return 0;
+        const SShardLock lock(*shard);
+        return ModifyEventTable(*shard, [&id](SEventTable &events) -> int
+            {
+                const SListener *listener = RemoveListener(events, id);
+                if (listener == nullptr)
+                    return 0;
+                CompactBucket(events, events.find(listener->event));
+                return 1;
             });
+    }
+
+    EVENTLISTENER_API int DeleteEventListeners(Span<const int> ids)
+    {
+        EVENTLISTENER_DEBUG("Deleting listeners.");
+        std::vector<std::pair<SEventShard *, int>> listeners;
+        for (int id : ids)
+        {
+            if (SEventShard *shard = ShardOfListener(id))
+                listeners.emplace_back(shard, id);
+        }
+        /* Group by shard so each shard is locked once, and compact each event once after its deletions. */
+        std::sort(listeners.begin(), listeners.end(), [](const std::pair<SEventShard *, int> &a, const std::pair<SEventShard *, int> &b) -> bool
+            {
+                return std::less<SEventShard *>()(a.first, b.first);
+            });
+        int count = 0;
+        std::vector<EventId> events;
+        for (auto first = listeners.begin(); first != listeners.end();)
+        {
+            SEventShard &shard = *first->first;
+            auto last = std::find_if(first, listeners.end(), [&shard](const std::pair<SEventShard *, int> &listener) -> bool { return listener.first != &shard; });
+            const SShardLock lock(shard);
+            count += ModifyEventTable(shard, [&first, &last, &events](SEventTable &table) -> int
+                {
+                    events.clear();
+                    for (auto listener = first; listener != last; ++listener)
+                        if (const SListener *removed = RemoveListener(table, listener->second))
+                            events.push_back(removed->event);
+                    std::sort(events.begin(), events.end());
+                    for (auto event = events.begin(); event != events.end(); ++event)
+                        if (std::next(event) == events.end() || *std::next(event) != *event)
+                        {
+                            auto bucket = table.find(*event);
+                            if (bucket != table.end())
+                                CompactBucket(table, bucket);
+                        }
+                    return (int)events.size();
+                });
+            first = last;
+        }
         return count;
     }
 
-    int DeleteEventListeners(const char *eventName)
+    EVENTLISTENER_API int DeleteEventListeners(void *objAddress)
     {
+        EVENTLISTENER_DEBUG("Scanning events.");
         int count = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Scanning listeners.");
-        filterVec<SListener>(g_events, [&eventName, &count](SListener &listener) -> bool
+        for (SEventShard &shard : g_shards)
+        {
+            const SShardLock lock(shard);
+            count += ModifyEventTable(shard, [&objAddress](SEventTable &events) -> int
+                {
+                    int count = 0;
+                    for (auto bucket = events.begin(); bucket != events.end();)
+                    {
+                        auto next = std::next(bucket);
+                        auto object = bucket->second.objects.find(objAddress);
+                        if (object != bucket->second.objects.end())
+                        {
+                            for (const SListener *listener : object->second)
+                                if (!listener->removed.load(std::memory_order_relaxed))
+                                {
+                                    MarkRemoved(bucket->second, listener);
+                                    ++count;
+                                }
+                            bucket->second.objects.erase(object);
+                            CompactBucket(events, bucket);
+                        }
+                        bucket = next;
+                    }
+                    return count;
+                });
+        }
+        return count;
+    }
+
+    EVENTLISTENER_API int DeleteEventListeners(EventId eventId)
+    {
+        SEventShard &shard = ShardOf(eventId);
+        const SShardLock lock(shard);
+        EVENTLISTENER_TRACE("Looking up event.");
+        return ModifyEventTable(shard, [&eventId](SEventTable &events) -> int
             {
-                EventListenerLog("Checking listener.");
-                if (listener.name == eventName)
+                auto bucket = events.find(eventId);
+                if (bucket == events.end())
+                    return 0;
+                int count = (int)(bucket->second.listeners.size() - bucket->second.removed);
+                for (const SListener *listener : bucket->second.listeners)
                 {
-                    EventListenerLog("Deleting listener.");
-                    return false;
-                    ++count;
+                    EVENTLISTENER_TRACE("Deleting listener.");
+                    const_cast<SListener *>(listener)->removed.store(true, std::memory_order_relaxed);
+                    RetireListener(listener->id);
                 }
-                else
-                    return true;
+                events.erase(bucket);
+                return count;
             });
-        return count;
     }
 
-    template <typename... Args>
-    int PushEvent(const char *eventName, Args... args)
+    EVENTLISTENER_API int DeleteEventListeners(const char *eventName)
     {
-        int count = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Scanning listeners.");
-        for (SListener &listener : g_events)
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : DeleteEventListeners(eventId);
+    }
+
+    EVENTLISTENER_API int DeleteEventListeners(const EventName &eventName)
+    {
+        EventId eventId = LookupEventName(eventName);
+        return eventId == EventId::Invalid ? 0 : DeleteEventListeners(eventId);
+    }
+
+    EVENTLISTENER_API bool HasTask(SDispatchQueue &queue)
+    {
+        return queue.ring ? !queue.ring->Empty() : !queue.tasks.empty();
+    }
+
+    EVENTLISTENER_API bool TryPopTask(SDispatchQueue &queue, EventTask &task)
+    {
+        if (queue.ring)
         {
-            EventListenerLog("Checking listener.");
-            if (listener.name == eventName)
+            if (!queue.ring->TryPop(task))
+                return false;
+            // A read-modify-write, so that it is ordered with WaitForRoom's increment: either this sees the producer
+            // blocked and wakes it, or the producer's increment reads this one and its retry sees the freed cell.
+            if (queue.blocked.fetch_add(0) != 0)
             {
-                EventListenerLog("Calling listener function.");
-                CallEvent(listener.address, eventName, std::forward<Args>(args)...);
-                ++count;
+                const std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.room.notify_all();
             }
+            return true;
         }
-        return count;
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
     }
 
-    template <typename... Args>
-    int PushEvent(void *objAddress, const char *eventName, Args... args)
+    /* Wakes FlushEvents callers waiting on `queue`. */
+    EVENTLISTENER_API void NotifyDrained(SDispatchQueue &queue)
     {
-        int count = 0;
-        const std::lock_guard<std::mutex> lock(g_events_mutex);
-        EventListenerLog("Scanning listeners.");
-        for (SListener &listener : g_events)
+        if (queue.flushing.load() != 0)
+        {
+            const std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.drained.notify_all();
+        }
+    }
+
+    /* Runs one event taken from (or meant for) `queue` and counts it as dispatched. */
+    EVENTLISTENER_API void RunTask(SDispatchQueue &queue, EventTask &task)
+    {
+        try
+        {
+            task();
+        } catch (...) {
+            EVENTLISTENER_WARN("Asynchronous event threw an exception.");
+        }
+        task = nullptr;
+        queue.completed.fetch_add(1);
+        NotifyDrained(queue);
+    }
+
+    EVENTLISTENER_API void RunDispatchQueue(SDispatchQueue &queue)
+    {
+        t_dispatch_queue = &queue;
+        EventTask task;
+        for (;;)
         {
-            EventListenerLog("Checking listener.");
-            if (listener.address == objAddress && listener.name == eventName)
+            if (TryPopTask(queue, task))
             {
-                EventListenerLog("Calling listener function.");
-                CallEvent(listener.address, eventName, std::forward<Args>(args)...);
-                ++count;
+                RunTask(queue, task);
+                continue;
             }
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.sleeping.store(true);
+            queue.ready.wait(lock, [&queue] { return queue.stopping || HasTask(queue); });
+            queue.sleeping.store(false);
+            if (!HasTask(queue))
+                return;
         }
-        return count;
+    }
+
+    /* Sleeps until `task` fits in the queue's full ring. */
+    EVENTLISTENER_API void WaitForRoom(SDispatchQueue &queue, EventTask &task)
+    {
+        queue.blocked.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.room.wait(lock, [&queue, &task] { return queue.ring->TryPush(task); });
+        }
+        queue.blocked.fetch_sub(1);
+    }
+
+    /*
+     * Returns false if the event was dropped by the queue's backpressure policy. A dispatcher thread never waits
+     * for room, since the thread it would wait for may be itself or be waiting for it: it returns true with the
+     * event still in `task`, for the caller to run inline.
+     */
+    EVENTLISTENER_API bool PushTask(SDispatchQueue &queue, EventTask &task)
+    {
+        queue.pushed.fetch_add(1);
+        if (!queue.ring)
+        {
+            const std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        else if (!queue.ring->TryPush(task))
+        {
+            switch (queue.backpressure)
+            {
+            case EBackpressure::Block:
+                if (t_dispatch_queue != nullptr)
+                    return true;
+                WaitForRoom(queue, task);
+                break;
+            case EBackpressure::DropNewest:
+                queue.dropped.fetch_add(1);
+                NotifyDrained(queue);
+                return false;
+            case EBackpressure::DropOldest:
+                do
+                {
+                    EventTask oldest;
+                    if (queue.ring->TryPop(oldest))
+                        queue.dropped.fetch_add(1);
+                } while (!queue.ring->TryPush(task));
+                NotifyDrained(queue);
+                break;
+            }
+        }
+        // The enqueue and this load are seq_cst, as are the consumer's store to `sleeping` and its emptiness
+        // check, so either the consumer sees the new event or this thread sees it asleep and wakes it.
+        if (queue.sleeping.load())
+        {
+            const std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.ready.notify_one();
+        }
+        return true;
+    }
+
+    EVENTLISTENER_API void StopEventDispatcher()
+    {
+        const std::lock_guard<std::shared_mutex> lock(g_dispatcher_mutex);
+        EVENTLISTENER_DEBUG("Stopping event dispatcher.");
+        for (auto &queue : g_dispatch_queues)
+        {
+            const std::lock_guard<std::mutex> queueLock(queue->mutex);
+            queue->stopping = true;
+            queue->ready.notify_one();
+        }
+        for (std::thread &thread : g_dispatch_threads)
+            thread.join();
+        g_dispatch_threads.clear();
+        g_dispatch_queues.clear();
+    }
+
+    EVENTLISTENER_API void StartEventDispatcher(const SDispatcherOptions &options)
+    {
+        StopEventDispatcher();
+        const std::lock_guard<std::shared_mutex> lock(g_dispatcher_mutex);
+        EVENTLISTENER_DEBUG("Starting event dispatcher.");
+        std::size_t threads = std::max<std::size_t>(options.threads, 1);
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            g_dispatch_queues.push_back(std::make_unique<SDispatchQueue>());
+            if (options.capacity)
+                g_dispatch_queues.back()->ring = std::make_unique<SRingBuffer<EventTask>>(options.capacity);
+            g_dispatch_queues.back()->backpressure = options.backpressure;
+        }
+        for (auto &queue : g_dispatch_queues)
+            g_dispatch_threads.emplace_back(RunDispatchQueue, std::ref(*queue));
+    }
+
+    EVENTLISTENER_API void StartEventDispatcher(std::size_t threads)
+    {
+        SDispatcherOptions options;
+        options.threads = threads;
+        StartEventDispatcher(options);
+    }
+
+    EVENTLISTENER_API void FlushEvents()
+    {
+        const std::shared_lock<std::shared_mutex> lock(g_dispatcher_mutex);
+        for (auto &queue : g_dispatch_queues)
+        {
+            queue->flushing.fetch_add(1);
+            const std::uint64_t target = queue->pushed.load();
+            std::unique_lock<std::mutex> queueLock(queue->mutex);
+            queue->drained.wait(queueLock, [&queue, target] { return queue->completed.load() + queue->dropped.load() >= target; });
+            queueLock.unlock();
+            queue->flushing.fetch_sub(1);
+        }
+    }
+
+    EVENTLISTENER_API SDispatcherStats GetDispatcherStats()
+    {
+        SDispatcherStats stats{0, 0, 0};
+        const std::shared_lock<std::shared_mutex> lock(g_dispatcher_mutex);
+        for (auto &queue : g_dispatch_queues)
+        {
+            stats.pushed += queue->pushed.load(std::memory_order_relaxed);
+            stats.dispatched += queue->completed.load(std::memory_order_relaxed);
+            stats.dropped += queue->dropped.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    EVENTLISTENER_API bool EnqueueEvent(void *objAddress, EventId eventId, EventTask task)
+    {
+        std::size_t key = std::hash<void *>()(objAddress) ^ (static_cast<std::size_t>(eventId) * 0x9E3779B97F4A7C15ull);
+        SDispatchQueue *queue = nullptr;
+        bool accepted = false;
+        for (;;)
+        {
+            {
+                // StopEventDispatcher holds the lock while it joins the dispatcher threads, so they must not wait for it.
+                std::shared_lock<std::shared_mutex> lock(g_dispatcher_mutex, std::defer_lock);
+                if (t_dispatch_queue != nullptr && !lock.try_lock())
+                {
+                    queue = t_dispatch_queue;
+                    queue->pushed.fetch_add(1);
+                    accepted = true;
+                    break;
+                }
+                if (!lock.owns_lock())
+                    lock.lock();
+                if (!g_dispatch_queues.empty())
+                {
+                    queue = g_dispatch_queues[key % g_dispatch_queues.size()].get();
+                    accepted = PushTask(*queue, task);
+                    break;
+                }
+            }
+            StartEventDispatcher();
+        }
+        // A dispatcher thread found its target full (see PushTask) or the dispatcher stopping. The queue stays
+        // alive without the lock, since stopping the dispatcher joins this thread before destroying the queues.
+        if (accepted && task)
+        {
+            EVENTLISTENER_DEBUG("Dispatcher queue full; running event inline.");
+            RunTask(*queue, task);
+        }
+        return accepted;
     }
 }
+#endif
 
 /* Push to the global namespace */
 using EventListener::CreateEventListener;
 using EventListener::DeleteEventListener;
 using EventListener::DeleteEventListeners;
+using EventListener::EBackpressure;
+using EventListener::ELogLevel;
+using EventListener::Event;
+using EventListener::EventEmitter;
 using EventListener::EventFunction;
+using EventListener::EventId;
+using EventListener::EventName;
+using EventListener::FlushEvents;
+using EventListener::GetDispatcherStats;
+using EventListener::GetEventName;
+using EventListener::GetListenerStats;
+using EventListener::GetShardStats;
+using EventListener::HashEventName;
+using EventListener::InplaceFunction;
+using EventListener::LogSink;
+using EventListener::LookupEventHash;
+using EventListener::LookupEventName;
 using EventListener::PushEvent;
+using EventListener::PushEventAsync;
+using EventListener::PushEventBatch;
+using EventListener::RegisterEventName;
+using EventListener::SDispatcherOptions;
+using EventListener::SDispatcherStats;
 using EventListener::SEvent;
+using EventListener::SLatencyHistogram;
+using EventListener::SListenerStats;
+using EventListener::SShardStats;
+using EventListener::SetListenerSampling;
+using EventListener::SetLogSink;
+using EventListener::Span;
+using EventListener::StartAsyncLogging;
+using EventListener::StartEventDispatcher;
+using EventListener::StaticDispatcher;
+using EventListener::StopAsyncLogging;
+using EventListener::StopEventDispatcher;
+using EventListener::Subscribe;
+using EventListener::Subscription;
+using EventListener::operator""_evt;
@@ -14,5 +14,12 @@ int main()
     PushEvent("Example", 50, "Test 1");
 
     // Example pushing an event with an address, int and string
-    PushEvent(0, "Example", 51, std::string("Test 2"));
+    PushEvent(static_cast<void*>(nullptr), "Example", 51, "Test 2");
+
+    // Example of a typed channel; the compiler checks the listener and the push
+    Event<int, const char*> typed("Typed");
+    typed.Listen([&](SEvent event, int a, const char* b){
+        std::cout << event.name << ' ' << a << ' ' << b << std::endl;
+    });
+    typed.Push(52, "Test 3");
 }
@@ -0,0 +1,204 @@
+/**
+ * @file async.cpp
+ * @brief Tests of asynchronous dispatch: per-key ordering, FlushEvents and the bounded queues' backpressure.
+ */
+
+#include "../eventlistener.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /* A listener of "Async.Gate" that holds its dispatcher thread until Open() is called. */
+    struct SGate
+    {
+        std::atomic<bool> entered{false};
+        std::atomic<bool> open{false};
+        int id = 0;
+
+        SGate()
+        {
+            id = CreateEventListener(nullptr, "Async.Gate", [this](SEvent) {
+                entered = true;
+                while (!open)
+                    std::this_thread::yield();
+            });
+        }
+
+        ~SGate() { DeleteEventListener(id); }
+
+        /* Pushes the gate event and waits until a dispatcher thread is held by it. */
+        void Close()
+        {
+            PushEventAsync("Async.Gate");
+            while (!entered)
+                std::this_thread::yield();
+        }
+
+        void Open() { open = true; }
+    };
+
+    void TestOrdering(const SDispatcherOptions &options)
+    {
+        StartEventDispatcher(options);
+        int objects[4] = {};
+        std::mutex mutex;
+        std::vector<int> seen[4];
+        for (int &object : objects)
+            CreateEventListener(&object, "Async.Order", [&](SEvent event, int value) {
+                const std::lock_guard<std::mutex> lock(mutex);
+                seen[(int *)event.address - objects].push_back(value);
+            });
+        for (int i = 0; i < 1000; ++i)
+            CHECK(PushEventAsync(static_cast<void *>(&objects[i % 4]), "Async.Order", i));
+        FlushEvents();
+        for (int object = 0; object < 4; ++object)
+        {
+            CHECK_EQ(seen[object].size(), 250);
+            for (std::size_t i = 0; i < seen[object].size(); ++i)
+                CHECK_EQ(seen[object][i], (int)i * 4 + object);
+        }
+        SDispatcherStats stats = GetDispatcherStats();
+        CHECK_EQ(stats.pushed, 1000);
+        CHECK_EQ(stats.dispatched, 1000);
+        CHECK_EQ(stats.dropped, 0);
+        CHECK_EQ(DeleteEventListeners("Async.Order"), 4);
+        StopEventDispatcher();
+    }
+
+    void TestFlushAndStop()
+    {
+        StartEventDispatcher(2);
+        std::atomic<int> sum{0};
+        int id = CreateEventListener(nullptr, "Async.Flush", [&sum](SEvent, int value) { sum += value; });
+        for (int i = 1; i <= 100; ++i)
+            PushEventAsync("Async.Flush", i);
+        FlushEvents();
+        CHECK_EQ(sum.load(), 5050);
+
+        // Stopping runs whatever is still queued.
+        for (int i = 1; i <= 100; ++i)
+            PushEventAsync("Async.Flush", i);
+        StopEventDispatcher();
+        CHECK_EQ(sum.load(), 10100);
+        CHECK_EQ(GetDispatcherStats().pushed, 0);
+
+        // Pushing with no dispatcher running starts one.
+        PushEventAsync("Async.Flush", 1);
+        FlushEvents();
+        CHECK_EQ(sum.load(), 10101);
+        DeleteEventListener(id);
+        StopEventDispatcher();
+    }
+
+    void TestDropNewest()
+    {
+        StartEventDispatcher(SDispatcherOptions{1, 4, EBackpressure::DropNewest});
+        std::vector<int> seen;
+        int id = CreateEventListener(nullptr, "Async.Drop", [&seen](SEvent, int value) { seen.push_back(value); });
+        SGate gate;
+        gate.Close();
+        int accepted = 0;
+        for (int i = 0; i < 10; ++i)
+            accepted += PushEventAsync("Async.Drop", i);
+        CHECK_EQ(accepted, 4);
+        gate.Open();
+        FlushEvents();
+        CHECK((seen == std::vector<int>{0, 1, 2, 3}));
+        SDispatcherStats stats = GetDispatcherStats();
+        CHECK_EQ(stats.pushed, 11);
+        CHECK_EQ(stats.dispatched, 5);
+        CHECK_EQ(stats.dropped, 6);
+        DeleteEventListener(id);
+        StopEventDispatcher();
+    }
+
+    void TestDropOldest()
+    {
+        StartEventDispatcher(SDispatcherOptions{1, 4, EBackpressure::DropOldest});
+        std::vector<int> seen;
+        int id = CreateEventListener(nullptr, "Async.Drop", [&seen](SEvent, int value) { seen.push_back(value); });
+        SGate gate;
+        gate.Close();
+        for (int i = 0; i < 10; ++i)
+            CHECK(PushEventAsync("Async.Drop", i));
+        gate.Open();
+        FlushEvents();
+        CHECK((seen == std::vector<int>{6, 7, 8, 9}));
+        SDispatcherStats stats = GetDispatcherStats();
+        CHECK_EQ(stats.pushed, 11);
+        CHECK_EQ(stats.dispatched, 5);
+        CHECK_EQ(stats.dropped, 6);
+        DeleteEventListener(id);
+        StopEventDispatcher();
+    }
+
+    void TestBlock()
+    {
+        StartEventDispatcher(SDispatcherOptions{1, 2, EBackpressure::Block});
+        std::vector<int> seen;
+        int id = CreateEventListener(nullptr, "Async.Block", [&seen](SEvent, int value) { seen.push_back(value); });
+        SGate gate;
+        gate.Close();
+        std::thread opener([&gate] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            gate.Open();
+        });
+        // The third push waits for room until the gate opens; nothing is dropped.
+        for (int i = 0; i < 50; ++i)
+            CHECK(PushEventAsync("Async.Block", i));
+        opener.join();
+        FlushEvents();
+        CHECK_EQ(seen.size(), 50);
+        for (std::size_t i = 0; i < seen.size(); ++i)
+            CHECK_EQ(seen[i], (int)i);
+        CHECK_EQ(GetDispatcherStats().dropped, 0);
+        DeleteEventListener(id);
+        StopEventDispatcher();
+    }
+
+    void TestBlockFromDispatcher()
+    {
+        // A listener on a dispatcher thread fanning out into its own full queue must not wait for itself.
+        StartEventDispatcher(SDispatcherOptions{1, 2, EBackpressure::Block});
+        std::atomic<int> leaves{0};
+        int fanOut = CreateEventListener(nullptr, "Async.FanOut", [](SEvent) {
+            for (int i = 0; i < 8; ++i)
+                CHECK(PushEventAsync("Async.Leaf"));
+        });
+        int leaf = CreateEventListener(nullptr, "Async.Leaf", [&leaves](SEvent) { ++leaves; });
+        CHECK(PushEventAsync("Async.FanOut"));
+        CHECK(PushEventAsync("Async.FanOut"));
+        // FlushEvents only waits for events pushed before it was called, and the leaves are pushed later.
+        while (GetDispatcherStats().dispatched < 18)
+            FlushEvents();
+        CHECK_EQ(leaves.load(), 16);
+        SDispatcherStats stats = GetDispatcherStats();
+        CHECK_EQ(stats.pushed, 18);
+        CHECK_EQ(stats.dispatched, 18);
+        CHECK_EQ(stats.dropped, 0);
+
+        // Stopping joins the dispatcher thread while it is still fanning out, so those pushes must not wait for the lock.
+        CHECK(PushEventAsync("Async.FanOut"));
+        StopEventDispatcher();
+        CHECK_EQ(leaves.load(), 24);
+        DeleteEventListener(fanOut);
+        DeleteEventListener(leaf);
+    }
+}
+
+int main()
+{
+    TestOrdering(SDispatcherOptions{4, 0, EBackpressure::Block});
+    TestOrdering(SDispatcherOptions{4, 16, EBackpressure::Block});
+    TestFlushAndStop();
+    TestDropNewest();
+    TestDropOldest();
+    TestBlock();
+    TestBlockFromDispatcher();
+    return Report("async");
+}
@@ -0,0 +1,118 @@
+/**
+ * @file channels.cpp
+ * @brief Tests of the registry-free channels: EventEmitter, Event<Args...> and StaticDispatcher.
+ */
+
+#include "../eventlistener.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    class CButton : public EventEmitter
+    {
+    };
+
+    // Subscriptions hold the emitter's address, so a move (e.g. std::vector<CButton> growing) must not compile.
+    static_assert(!std::is_copy_constructible_v<CButton> && !std::is_move_constructible_v<CButton>);
+    static_assert(!std::is_copy_assignable_v<CButton> && !std::is_move_assignable_v<CButton>);
+
+    void TestEmitter()
+    {
+        CButton button;
+        CButton other;
+        int clicks = 0;
+        const void *address = nullptr;
+        int id = button.Listen("Channels.Click", [&](SEvent event, int count) {
+            clicks += count;
+            address = (const void *)event.address;
+        });
+        button.Listen("Channels.Hover", [&clicks](SEvent) { clicks += 100; });
+        CHECK_EQ(button.Emit("Channels.Click", 2), 1);
+        CHECK_EQ(clicks, 2);
+        CHECK(address == static_cast<EventEmitter *>(&button));
+
+        // Emitters do not share listeners, neither with each other nor with the global registry.
+        CHECK_EQ(other.Emit("Channels.Click", 1), 0);
+        CHECK_EQ(PushEvent("Channels.Click", 1), 0);
+        CHECK_EQ(button.Emit("Channels.Click", std::string("wrong type")), 0);
+        CHECK_EQ(button.Emit("Channels.Unknown", 1), 0);
+
+        // Arguments decay as they do for PushEvent: a string literal reaches a const char * listener as a pointer.
+        std::string text;
+        button.Listen("Channels.Text", [&text](SEvent, const char *value, int count) { text.append(value).append(std::to_string(count)); });
+        const char *pointer = "b";
+        const int two = 2;
+        CHECK_EQ(button.Emit("Channels.Text", "a", 1), 1);
+        CHECK_EQ(button.Emit(LookupEventName("Channels.Text"), pointer, two), 1);
+        CHECK(text == "a1b2");
+        CHECK_EQ(button.UnlistenAll(LookupEventName("Channels.Text")), 1);
+
+        CHECK_EQ(button.Unlisten(id), 1);
+        CHECK_EQ(button.Unlisten(id), 0);
+        CHECK_EQ(button.Emit("Channels.Click", 1), 0);
+        {
+            Subscription subscription = button.Subscribe("Channels.Click", [&clicks](SEvent, int count) { clicks += count; });
+            CHECK_EQ(button.Emit("Channels.Click", 3), 1);
+        }
+        CHECK_EQ(button.Emit("Channels.Click", 3), 0);
+        CHECK_EQ(clicks, 5);
+
+        button.Listen("Channels.Click", [](SEvent, int) {});
+        CHECK_EQ(button.UnlistenAll(LookupEventName("Channels.Click")), 1);
+        CHECK_EQ(button.Emit("Channels.Hover"), 1);
+        CHECK_EQ(button.UnlistenAll(), 1);
+        CHECK_EQ(button.Emit("Channels.Hover"), 0);
+    }
+
+    void TestEvent()
+    {
+        Event<int, const std::string &> changed("Channels.Changed");
+        std::vector<std::string> seen;
+        int first = changed.Listen([&seen](SEvent event, int value, const std::string &text) {
+            CHECK(event.name == "Channels.Changed");
+            seen.push_back(std::to_string(value) + text);
+        });
+        std::string text = "a";
+        CHECK_EQ(changed.Push(1, text), 1);
+        {
+            Subscription subscription = changed.Subscribe([&seen](SEvent, int, const std::string &text) { seen.push_back(text); });
+            CHECK_EQ(changed(2, text), 2);
+        }
+        CHECK_EQ(changed(3, text), 1);
+        CHECK_EQ(changed.Unlisten(first), 1);
+        CHECK_EQ(changed(4, text), 0);
+        CHECK((seen == std::vector<std::string>{"1a", "2a", "a", "3a"}));
+
+        // Typed channels never touch the global registry.
+        CHECK_EQ(PushEvent("Channels.Changed", 5, text), 0);
+    }
+
+    std::vector<int> g_order;
+
+    void First(const SEvent &, int value) { g_order.push_back(value); }
+    void Second(int value) { g_order.push_back(value * 10); }
+
+    struct SStaticTag
+    {
+    };
+
+    void TestStaticDispatcher()
+    {
+        using Dispatcher = StaticDispatcher<SStaticTag, &First, &Second>;
+        CHECK_EQ(Dispatcher::Push(1), 2);
+        CHECK_EQ(Dispatcher()(2), 2);
+        CHECK((g_order == std::vector<int>{1, 10, 2, 20}));
+    }
+}
+
+int main()
+{
+    TestEmitter();
+    TestEvent();
+    TestStaticDispatcher();
+    return Report("channels");
+}
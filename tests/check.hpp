@@ -0,0 +1,26 @@
+/**
+ * @file check.hpp
+ * @brief Minimal checking helpers shared by the test programs.
+ *
+ * assert() is compiled out of release builds, so the tests count failed CHECKs themselves and main() returns
+ * Report(), which is non-zero if any check failed.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+inline int g_failures = 0;
+
+#define CHECK(condition) \
+    ((condition) ? (void)0 : (void)(++g_failures, std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition)))
+
+#define CHECK_EQ(actual, expected) \
+    (((actual) == (expected)) ? (void)0 : (void)(++g_failures, std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: got %lld, expected %lld\n", \
+        __FILE__, __LINE__, #actual, #expected, (long long)(actual), (long long)(expected))))
+
+inline int Report(const char *suite)
+{
+    std::printf("%s: %s (%d failed checks)\n", suite, g_failures ? "FAIL" : "OK", g_failures);
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file logging.cpp
+ * @brief Tests of the log sink and of asynchronous logging.
+ */
+
+#include "../eventlistener.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    std::mutex g_mutex;
+    std::vector<std::pair<ELogLevel, const char *>> g_messages;
+    std::vector<std::thread::id> g_threads;
+    std::atomic<int> g_count{0};
+
+    void Record(ELogLevel level, const char *text)
+    {
+        const std::lock_guard<std::mutex> lock(g_mutex);
+        g_messages.emplace_back(level, text);
+        g_threads.push_back(std::this_thread::get_id());
+        g_count.fetch_add(1);
+    }
+
+    void Clear()
+    {
+        const std::lock_guard<std::mutex> lock(g_mutex);
+        g_messages.clear();
+        g_threads.clear();
+        g_count.store(0);
+    }
+
+    void TestSink()
+    {
+        const char *text = "Logging.Sink";
+        SetLogSink(&Record);
+        EventListener::WriteLog(ELogLevel::Warning, text);
+        CHECK_EQ(g_count.load(), 1);
+        CHECK(g_messages[0].first == ELogLevel::Warning);
+        CHECK(g_messages[0].second == text);
+        CHECK(g_threads[0] == std::this_thread::get_id());
+
+        SetLogSink(nullptr);
+        CHECK(EventListener::g_log_sink.load() == &EventListener::WriteLogLine);
+        Clear();
+    }
+
+    void TestAsync()
+    {
+        SetLogSink(&Record);
+        StartAsyncLogging();
+        StartAsyncLogging();
+        const char *texts[] = {"Logging.First", "Logging.Second", "Logging.Third"};
+        for (const char *text : texts)
+            EventListener::WriteLog(ELogLevel::Error, text);
+        // Stopping writes out everything queued, in order, from the background thread.
+        StopAsyncLogging();
+        CHECK_EQ(g_count.load(), 3);
+        for (std::size_t i = 0; i < g_messages.size(); ++i)
+        {
+            CHECK(g_messages[i].second == texts[i]);
+            CHECK(g_threads[i] != std::this_thread::get_id());
+        }
+        StopAsyncLogging();
+
+        // Back to direct calls.
+        EventListener::WriteLog(ELogLevel::Error, texts[0]);
+        CHECK_EQ(g_count.load(), 4);
+        CHECK(g_threads.back() == std::this_thread::get_id());
+        SetLogSink(nullptr);
+        Clear();
+    }
+
+    void TestRestartRace()
+    {
+        // Starting and stopping from several threads while others log: no message is lost and the writer is always joined.
+        SetLogSink(&Record);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; ++t)
+            threads.emplace_back([] {
+                for (int i = 0; i < 300; ++i)
+                {
+                    StartAsyncLogging();
+                    StopAsyncLogging();
+                }
+            });
+        for (int t = 0; t < 2; ++t)
+            threads.emplace_back([] {
+                for (int i = 0; i < 2000; ++i)
+                    EventListener::WriteLog(ELogLevel::Debug, "Logging.Race");
+            });
+        for (std::thread &thread : threads)
+            thread.join();
+        StopAsyncLogging();
+        CHECK_EQ(g_count.load(), 4000);
+        SetLogSink(nullptr);
+        Clear();
+    }
+}
+
+int main()
+{
+    TestSink();
+    TestAsync();
+    TestRestartRace();
+    return Report("logging");
+}
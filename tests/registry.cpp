@@ -0,0 +1,595 @@
+/**
+ * @file registry.cpp
+ * @brief Tests of the global listener registry: creation, priorities, deletion, IDs, subscriptions and pushes.
+ */
+
+#include "../eventlistener.hpp"
+#include "check.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    // Every bucket starts where the previous one ends, and BucketOf maps each bucket's bounds back to it.
+    constexpr bool BucketsAreContiguous()
+    {
+        for (std::size_t bucket = 1; bucket < SLatencyHistogram::kBuckets; ++bucket)
+        {
+            std::uint64_t lower = SLatencyHistogram::LowerBound(bucket);
+            if (lower <= SLatencyHistogram::LowerBound(bucket - 1) || SLatencyHistogram::BucketOf(lower) != bucket || SLatencyHistogram::BucketOf(lower - 1) != bucket - 1)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(SLatencyHistogram::BucketOf(0) == 0 && SLatencyHistogram::BucketOf(7) == 7);
+    static_assert(SLatencyHistogram::BucketOf(8) == 8 && SLatencyHistogram::BucketOf(10) == 9 && SLatencyHistogram::BucketOf(15) == 11);
+    static_assert(SLatencyHistogram::BucketOf(16) == 12 && SLatencyHistogram::LowerBound(12) == 16);
+    static_assert(SLatencyHistogram::BucketOf((1ull << 36) - 1) == SLatencyHistogram::kBuckets - 2);
+    static_assert(SLatencyHistogram::BucketOf(1ull << 36) == SLatencyHistogram::kBuckets - 1 && SLatencyHistogram::BucketOf(~0ull) == SLatencyHistogram::kBuckets - 1);
+    static_assert(SLatencyHistogram::LowerBound(SLatencyHistogram::kBuckets - 1) == 1ull << 36);
+    static_assert(BucketsAreContiguous());
+
+    void TestPushAndFilter()
+    {
+        int a = 0, b = 0;
+        std::vector<int> seen;
+        CreateEventListener(&a, "Registry.Push", [&seen](SEvent, int value) { seen.push_back(value); });
+        CreateEventListener(&b, "Registry.Push", [&seen](SEvent, int value) { seen.push_back(-value); });
+        CHECK_EQ(PushEvent("Registry.Push", 1), 2);
+        CHECK_EQ(PushEvent(static_cast<void *>(&a), "Registry.Push", 2), 1);
+        CHECK_EQ(PushEvent(static_cast<void *>(&b), "Registry.Push", 3), 1);
+        CHECK((seen == std::vector<int>{1, -1, 2, -3}));
+
+        // Pushes with other argument types, and pushes of unknown events, reach nobody.
+        CHECK_EQ(PushEvent("Registry.Push", std::string("text")), 0);
+        CHECK_EQ(PushEvent("Registry.Unknown", 1), 0);
+        CHECK_EQ(DeleteEventListeners("Registry.Push"), 2);
+        CHECK_EQ(PushEvent("Registry.Push", 4), 0);
+    }
+
+    void TestEventFunctionPointer()
+    {
+        // The listener only borrows the EventFunction: one can serve several events and live on the stack.
+        int calls = 0;
+        EventFunction<int> function = [&calls](SEvent, int value) { calls += value; };
+        int first = CreateEventListener(nullptr, "Registry.PointerA", &function);
+        int second = CreateEventListener(nullptr, "Registry.PointerB", &function);
+        CHECK_EQ(PushEvent("Registry.PointerA", 1), 1);
+        CHECK_EQ(PushEvent("Registry.PointerB", 2), 1);
+        CHECK_EQ(DeleteEventListener(first), 1);
+        CHECK_EQ(PushEvent("Registry.PointerB", 4), 1);
+        CHECK_EQ(DeleteEventListener(second), 1);
+        CHECK_EQ(calls, 7);
+
+        // Deleting the listeners left the function alone.
+        function(SEvent{}, 8);
+        CHECK_EQ(calls, 15);
+    }
+
+    void TestSEventFields()
+    {
+        int object = 0;
+        SEvent received{};
+        int id = CreateEventListener(&object, "Registry.SEvent", [&received](SEvent event) { received = event; });
+        PushEvent("Registry.SEvent");
+        CHECK_EQ(received.id, id);
+        CHECK(received.address == (uintptr_t)&object);
+        CHECK(received.name == "Registry.SEvent");
+        CHECK(received.event == LookupEventName("Registry.SEvent"));
+        CHECK(GetEventName(received.event) == "Registry.SEvent");
+        DeleteEventListener(id);
+    }
+
+    void TestPriorities()
+    {
+        std::vector<std::string> order;
+        CreateEventListener(nullptr, "Registry.Priority", [&order](SEvent) { order.push_back("0a"); });
+        CreateEventListener(nullptr, "Registry.Priority", [&order](SEvent) { order.push_back("5a"); }, 5);
+        CreateEventListener(nullptr, "Registry.Priority", [&order](SEvent) { order.push_back("-1"); }, -1);
+        CreateEventListener(nullptr, "Registry.Priority", [&order](SEvent) { order.push_back("5b"); }, 5);
+        CreateEventListener(nullptr, "Registry.Priority", [&order](SEvent) { order.push_back("0b"); });
+        PushEvent("Registry.Priority");
+        CHECK((order == std::vector<std::string>{"5a", "5b", "0a", "0b", "-1"}));
+        DeleteEventListeners("Registry.Priority");
+    }
+
+    void TestStaleIds()
+    {
+        int calls = 0;
+        int first = CreateEventListener(nullptr, "Registry.Stale", [&calls](SEvent) { ++calls; });
+        CHECK(first != 0);
+        CHECK_EQ(DeleteEventListener(first), 1);
+        CHECK_EQ(DeleteEventListener(first), 0);
+
+        // A new listener may reuse the slot, but never the ID; the stale ID must not delete it.
+        int second = CreateEventListener(nullptr, "Registry.Stale", [&calls](SEvent) { ++calls; });
+        CHECK(second != first);
+        CHECK_EQ(DeleteEventListener(first), 0);
+        CHECK_EQ(PushEvent("Registry.Stale"), 1);
+        CHECK_EQ(DeleteEventListener(second), 1);
+        CHECK_EQ(DeleteEventListener(0), 0);
+        CHECK_EQ(DeleteEventListener(-5), 0);
+        CHECK_EQ(DeleteEventListener(0x7fffffff), 0);
+        CHECK_EQ(calls, 1);
+    }
+
+    void TestIdsNotReissuedSoon()
+    {
+        // Freed slots wait behind a reserve of newer ones, so churn reissues no ID, and a stale one stays stale.
+        int live = CreateEventListener(nullptr, "Registry.Churn.Live", [](SEvent) {});
+        int stale = CreateEventListener(nullptr, "Registry.Churn", [](SEvent) {});
+        CHECK_EQ(DeleteEventListener(stale), 1);
+        std::unordered_set<int> issued{live, stale};
+        bool unique = true;
+        for (int i = 0; i < 50000; ++i)
+        {
+            int id = CreateEventListener(nullptr, "Registry.Churn", [](SEvent) {});
+            unique &= id != 0 && issued.insert(id).second;
+            DeleteEventListener(id);
+        }
+        CHECK(unique);
+        CHECK_EQ(DeleteEventListener(stale), 0);
+        CHECK_EQ(PushEvent("Registry.Churn.Live"), 1);
+        CHECK_EQ(DeleteEventListener(live), 1);
+    }
+
+    void TestSubscription()
+    {
+        int calls = 0;
+        {
+            Subscription subscription = Subscribe(nullptr, "Registry.Subscribe", [&calls](SEvent) { ++calls; });
+            CHECK((bool)subscription);
+            CHECK_EQ(PushEvent("Registry.Subscribe"), 1);
+
+            Subscription moved = std::move(subscription);
+            CHECK(!subscription);
+            CHECK_EQ(PushEvent("Registry.Subscribe"), 1);
+        }
+        CHECK_EQ(PushEvent("Registry.Subscribe"), 0);
+        CHECK_EQ(calls, 2);
+
+        Subscription explicitly = Subscribe(nullptr, "Registry.Subscribe", [&calls](SEvent) { ++calls; });
+        CHECK_EQ(explicitly.Unsubscribe(), 1);
+        CHECK_EQ(explicitly.Unsubscribe(), 0);
+        CHECK_EQ(PushEvent("Registry.Subscribe"), 0);
+
+        // A subscription whose listener was deleted by other means unsubscribes nothing.
+        Subscription orphaned = Subscribe(nullptr, "Registry.Subscribe", [&calls](SEvent) { ++calls; });
+        CHECK_EQ(DeleteEventListeners("Registry.Subscribe"), 1);
+        CHECK_EQ(orphaned.Unsubscribe(), 0);
+
+        int released;
+        {
+            Subscription subscription = Subscribe(nullptr, "Registry.Subscribe", [&calls](SEvent) { ++calls; });
+            released = subscription.Release();
+        }
+        CHECK_EQ(PushEvent("Registry.Subscribe"), 1);
+        CHECK_EQ(DeleteEventListener(released), 1);
+    }
+
+    void TestCompaction()
+    {
+        int object = 0;
+        int calls = 0;
+        std::vector<int> ids;
+        for (int i = 0; i < 100; ++i)
+            ids.push_back(CreateEventListener(&object, "Registry.Compact", [&calls](SEvent) { ++calls; }));
+
+        // Deleting more than half triggers compaction; pushes and deletes must see the same listeners before and after.
+        for (int i = 0; i < 60; ++i)
+            CHECK_EQ(DeleteEventListener(ids[i]), 1);
+        CHECK_EQ(PushEvent("Registry.Compact"), 40);
+        CHECK_EQ(PushEvent(static_cast<void *>(&object), "Registry.Compact"), 40);
+        CHECK_EQ(calls, 80);
+        for (int i = 0; i < 60; ++i)
+            CHECK_EQ(DeleteEventListener(ids[i]), 0);
+        for (int i = 60; i < 100; i += 2)
+            CHECK_EQ(DeleteEventListener(ids[i]), 1);
+        CHECK_EQ(PushEvent("Registry.Compact"), 20);
+        CHECK_EQ(DeleteEventListeners(static_cast<void *>(&object)), 20);
+        CHECK_EQ(PushEvent("Registry.Compact"), 0);
+    }
+
+    void TestManyListeners()
+    {
+        // Enough listeners to span several slabs of records, deleted and re-created so their slots are reused.
+        int calls = 0;
+        std::vector<int> ids;
+        for (int round = 0; round < 3; ++round)
+        {
+            for (int i = 0; i < 600; ++i)
+                ids.push_back(CreateEventListener(nullptr, "Registry.Many", [&calls](SEvent) { ++calls; }));
+            CHECK_EQ(PushEvent("Registry.Many"), 600);
+            std::size_t live = 0;
+            for (const SListenerStats &stats : GetListenerStats())
+                live += stats.name == "Registry.Many";
+            CHECK_EQ(live, 600);
+            CHECK_EQ(DeleteEventListeners(ids), 600);
+            CHECK_EQ(DeleteEventListeners(ids), 0);
+            ids.clear();
+        }
+        CHECK_EQ(calls, 1800);
+    }
+
+    void TestBatchDelete()
+    {
+        int object = 0;
+        std::vector<int> ids;
+        for (int i = 0; i < 10; ++i)
+            ids.push_back(CreateEventListener(&object, i % 2 ? "Registry.BatchA" : "Registry.BatchB", [](SEvent) {}));
+        int stale = CreateEventListener(nullptr, "Registry.BatchA", [](SEvent) {});
+        DeleteEventListener(stale);
+
+        std::vector<int> doomed = {ids[0], ids[1], ids[2], ids[3], ids[4], ids[0], stale, 0};
+        CHECK_EQ(DeleteEventListeners(doomed), 5);
+        CHECK_EQ(DeleteEventListeners({ids[0], ids[5]}), 1);
+        CHECK_EQ(PushEvent("Registry.BatchA") + PushEvent("Registry.BatchB"), 4);
+        CHECK_EQ(DeleteEventListeners(Span<const int>()), 0);
+        CHECK_EQ(DeleteEventListeners(static_cast<void *>(&object)), 4);
+    }
+
+    void TestConcurrentChurn()
+    {
+        // Threads creating and deleting listeners of events in different shards, while another reads the stats.
+        std::atomic<int> failures{0};
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back([t, &failures] {
+                std::string name = "Registry.Churn." + std::to_string(t);
+                for (int i = 0; i < 5000; ++i)
+                {
+                    int id = CreateEventListener(nullptr, name.c_str(), [](SEvent) {});
+                    if (id == 0 || PushEvent(name.c_str()) != 1 || DeleteEventListener(id) != 1 || DeleteEventListener(id) != 0)
+                        ++failures;
+                }
+            });
+        std::thread reader([&done] {
+            while (!done.load())
+                GetListenerStats();
+        });
+        for (std::thread &thread : threads)
+            thread.join();
+        done.store(true);
+        reader.join();
+        CHECK_EQ(failures.load(), 0);
+    }
+
+    void TestDeleteDuringPush()
+    {
+        int calls = 0;
+        int second = 0;
+        int first = CreateEventListener(nullptr, "Registry.Reentrant", [&calls, &second](SEvent event) {
+            ++calls;
+            DeleteEventListener(event.id);
+            DeleteEventListener(second);
+            CreateEventListener(nullptr, "Registry.Reentrant.Inner", [&calls](SEvent) { ++calls; });
+            PushEvent("Registry.Reentrant.Inner");
+        });
+        second = CreateEventListener(nullptr, "Registry.Reentrant", [&calls](SEvent) { calls += 100; });
+        CHECK_EQ(PushEvent("Registry.Reentrant"), 1);
+        CHECK_EQ(calls, 2);
+        CHECK_EQ(PushEvent("Registry.Reentrant"), 0);
+        CHECK_EQ(DeleteEventListener(first), 0);
+        DeleteEventListeners("Registry.Reentrant.Inner");
+    }
+
+    void TestChurnWhileDispatching()
+    {
+        // More create/delete cycles than the slot map has slots, all inside one dispatch while another thread keeps pushing.
+        std::atomic<bool> done{false};
+        std::thread pusher([&done] {
+            while (!done.load())
+                PushEvent("Registry.Churn.Busy");
+        });
+        int failures = 0;
+        CreateEventListener(nullptr, "Registry.Churn", [&failures, &done, &pusher](SEvent) {
+            for (int i = 0; i < 1100000; ++i)
+            {
+                int id = CreateEventListener(nullptr, "Registry.Churn.Inner", [](SEvent) {});
+                if (id == 0)
+                    ++failures;
+                DeleteEventListener(id);
+            }
+            done.store(true);
+            pusher.join();
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+            // Once the pusher is gone, only the tables this dispatch may still be reading are kept.
+            DeleteEventListener(CreateEventListener(nullptr, "Registry.Churn.Inner", [](SEvent) {}));
+            CHECK(EventListener::ShardOf(LookupEventName("Registry.Churn.Inner")).retired.size() <= 2);
+#endif
+        });
+        PushEvent("Registry.Churn");
+        CHECK_EQ(failures, 0);
+        DeleteEventListeners("Registry.Churn");
+    }
+
+    void TestEventNames()
+    {
+        int calls = 0;
+        CreateEventListener(nullptr, "Registry.Literal"_evt, [&calls](SEvent event, int value) {
+            calls += value;
+            CHECK(event.name == "Registry.Literal");
+        });
+        CHECK_EQ(PushEvent<"Registry.Literal"_evt>(1), 1);
+        CHECK_EQ(PushEvent("Registry.Literal"_evt, 2), 1);
+        CHECK_EQ(PushEvent("Registry.Literal", 4), 1);
+        CHECK_EQ(calls, 7);
+        CHECK(LookupEventHash(HashEventName("Registry.Literal")) == LookupEventName("Registry.Literal"));
+        CHECK(LookupEventName("Registry.NeverRegistered") == EventId::Invalid);
+        CHECK_EQ(PushEvent<"Registry.NeverRegistered"_evt>(1), 0);
+        CHECK_EQ(DeleteEventListeners("Registry.Literal"_evt), 1);
+    }
+
+    void TestHashCollisions()
+    {
+        // An EventName carrying another registered name's hash, as a real collision would.
+        int first = 0, second = 0;
+        CreateEventListener(nullptr, "Registry.Hash.First", [&first](SEvent) { ++first; });
+        const EventName colliding{HashEventName("Registry.Hash.First"), "Registry.Hash.Second"};
+        const EventName unregistered{HashEventName("Registry.Hash.First"), "Registry.Hash.Unregistered"};
+        CHECK(LookupEventName(unregistered) == EventId::Invalid);
+        CHECK_EQ(PushEvent(unregistered), 0);
+        CHECK_EQ(DeleteEventListeners(unregistered), 0);
+
+        CreateEventListener(nullptr, colliding, [&second](SEvent) { ++second; });
+        CHECK(LookupEventName(colliding) == LookupEventName("Registry.Hash.Second"));
+        CHECK(LookupEventName(colliding) != LookupEventName("Registry.Hash.First"));
+        CHECK_EQ(PushEvent(colliding), 1);
+        CHECK_EQ(first, 0);
+        CHECK_EQ(second, 1);
+        CHECK_EQ(DeleteEventListeners(colliding), 1);
+        CHECK_EQ(PushEvent("Registry.Hash.First"), 1);
+        CHECK_EQ(DeleteEventListeners("Registry.Hash.First"), 1);
+    }
+
+    void TestConcurrentNames()
+    {
+        int calls = 0;
+        int id = CreateEventListener(nullptr, "Registry.Names", [&calls](SEvent) { ++calls; });
+        std::vector<std::string> names;
+        for (int i = 0; i < 200; ++i)
+            names.push_back("Registry.Names." + std::to_string(i));
+
+        // Lookups keep resolving an existing name while other names are registered (and, in copy-on-write mode, republished).
+        std::thread registrar([&names] {
+            for (const std::string &name : names)
+                RegisterEventName(name);
+        });
+        int pushes = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            CHECK(LookupEventHash(HashEventName("Registry.Names")) != EventId::Invalid);
+            pushes += PushEvent("Registry.Names");
+        }
+        registrar.join();
+        CHECK_EQ(pushes, 2000);
+        CHECK_EQ(calls, 2000);
+        for (const std::string &name : names)
+        {
+            EventId event = LookupEventName(name);
+            CHECK(event != EventId::Invalid);
+            CHECK(LookupEventHash(HashEventName(name)) == event);
+            CHECK(GetEventName(event) == name);
+        }
+        DeleteEventListener(id);
+
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        // Names registered during a dispatch do not pile up copies of the name maps.
+        int inner = CreateEventListener(nullptr, "Registry.Names", [](SEvent) {
+            for (int i = 0; i < 200; ++i)
+                RegisterEventName("Registry.Names.Inner." + std::to_string(i));
+            CHECK(EventListener::g_event_name_tables.retired.size() <= 2);
+        });
+        PushEvent("Registry.Names");
+        DeleteEventListener(inner);
+#endif
+    }
+
+    void TestPushEventBatch()
+    {
+        std::vector<int> payloads = {1, 2, 3, 4};
+        int batches = 0, batchSum = 0, itemCalls = 0, itemSum = 0;
+        CreateEventListener(nullptr, "Registry.Batch", [&](SEvent, Span<const int> batch) {
+            ++batches;
+            for (int value : batch)
+                batchSum += value;
+        });
+        CreateEventListener(nullptr, "Registry.Batch", [&](SEvent, int value) {
+            ++itemCalls;
+            itemSum += value;
+        });
+        CHECK_EQ(PushEventBatch("Registry.Batch", payloads), 2);
+        CHECK_EQ(batches, 1);
+        CHECK_EQ(batchSum, 10);
+        CHECK_EQ(itemCalls, 4);
+        CHECK_EQ(itemSum, 10);
+        CHECK_EQ(PushEventBatch("Registry.Batch", std::vector<int>()), 1);
+        CHECK_EQ(PushEventBatch("Registry.Batch"_evt, Span<const int>(payloads.data(), 2)), 2);
+        CHECK_EQ(itemSum, 13);
+        DeleteEventListeners("Registry.Batch");
+    }
+
+    void TestExceptionsAndStats()
+    {
+        int id = CreateEventListener(nullptr, "Registry.Stats", [](SEvent, int value) {
+            if (value < 0)
+                throw std::runtime_error("negative");
+        });
+        for (int i = -2; i < 3; ++i)
+            CHECK_EQ(PushEvent("Registry.Stats", i), 1);
+        bool found = false;
+        for (const SListenerStats &stats : GetListenerStats())
+            if (stats.id == id)
+            {
+                found = true;
+                CHECK_EQ(stats.calls, 5);
+                CHECK_EQ(stats.exceptions, 2);
+                CHECK(stats.name == "Registry.Stats");
+            }
+        CHECK(found);
+        DeleteEventListener(id);
+        for (const SListenerStats &stats : GetListenerStats())
+            CHECK(stats.id != id);
+
+        // Calls from several threads at once are all counted, whether or not they are timed.
+        for (std::uint32_t period : {0u, 3u})
+        {
+            SetListenerSampling(period);
+            int shared = CreateEventListener(nullptr, "Registry.Stats.Shared", [](SEvent) {});
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t)
+                threads.emplace_back([] {
+                    for (int i = 0; i < 10000; ++i)
+                        PushEvent("Registry.Stats.Shared");
+                });
+            for (std::thread &thread : threads)
+                thread.join();
+            for (const SListenerStats &stats : GetListenerStats())
+                if (stats.id == shared)
+                {
+                    CHECK_EQ(stats.calls, 40000);
+                    CHECK_EQ(stats.sampled, period == 0 ? 0 : (40000 + period - 1) / period);
+                    CHECK_EQ(stats.latency.Total(), stats.sampled);
+                }
+            DeleteEventListener(shared);
+        }
+        SetListenerSampling(0);
+    }
+
+    const SListenerStats *StatsOf(const std::vector<SListenerStats> &stats, int id)
+    {
+        for (const SListenerStats &entry : stats)
+            if (entry.id == id)
+                return &entry;
+        return nullptr;
+    }
+
+    void TestSampling()
+    {
+        // Period N times the 1st, (N+1)th, ... call of each listener; 0 times nothing.
+        int id = CreateEventListener(nullptr, "Registry.Sampling", [](SEvent) {});
+        SetListenerSampling(4);
+        for (int i = 0; i < 10; ++i)
+            PushEvent("Registry.Sampling");
+        std::vector<SListenerStats> stats = GetListenerStats();
+        const SListenerStats *entry = StatsOf(stats, id);
+        CHECK(entry != nullptr && entry->calls == 10 && entry->sampled == 3 && entry->latency.Total() == 3);
+        SetListenerSampling(0);
+        for (int i = 0; i < 10; ++i)
+            PushEvent("Registry.Sampling");
+        stats = GetListenerStats();
+        entry = StatsOf(stats, id);
+        CHECK(entry != nullptr && entry->calls == 20 && entry->sampled == 3);
+        DeleteEventListener(id);
+
+        // With every call timed, the total and the histogram reflect how long the listener ran.
+        const auto pause = std::chrono::milliseconds(1);
+        id = CreateEventListener(nullptr, "Registry.Sampling.Slow", [&pause](SEvent) { std::this_thread::sleep_for(pause); });
+        SetListenerSampling(1);
+        for (int i = 0; i < 4; ++i)
+            PushEvent("Registry.Sampling.Slow");
+        SetListenerSampling(0);
+        stats = GetListenerStats();
+        entry = StatsOf(stats, id);
+        CHECK(entry != nullptr);
+        if (entry != nullptr)
+        {
+            CHECK_EQ(entry->sampled, 4);
+            CHECK(entry->totalNanoseconds >= 4000000);
+            CHECK_EQ(entry->latency.Total(), 4);
+            std::uint64_t below = 0;
+            for (std::size_t bucket = 0; bucket < SLatencyHistogram::BucketOf(1000000); ++bucket)
+                below += entry->latency.counts[bucket];
+            CHECK_EQ(below, 0);
+            CHECK(entry->latency.Percentile(50) >= 1000000);
+            CHECK(entry->latency.Percentile(100) * 4 >= entry->totalNanoseconds);
+        }
+        DeleteEventListener(id);
+    }
+
+    void TestPercentiles()
+    {
+        SLatencyHistogram histogram;
+        CHECK_EQ(histogram.Percentile(50), 0);
+        histogram.counts[SLatencyHistogram::BucketOf(10)] = 90;
+        histogram.counts[SLatencyHistogram::BucketOf(1000)] = 10;
+        CHECK_EQ(histogram.Total(), 100);
+        // A percentile reports the largest value of its bucket.
+        CHECK_EQ(histogram.Percentile(0), 11);
+        CHECK_EQ(histogram.Percentile(50), 11);
+        CHECK_EQ(histogram.Percentile(90), 11);
+        CHECK_EQ(histogram.Percentile(95), SLatencyHistogram::LowerBound(SLatencyHistogram::BucketOf(1000) + 1) - 1);
+        CHECK_EQ(histogram.Percentile(100), 1023);
+        histogram.counts[SLatencyHistogram::kBuckets - 1] = 100;
+        CHECK_EQ(histogram.Percentile(100), SLatencyHistogram::LowerBound(SLatencyHistogram::kBuckets - 1));
+    }
+
+    void TestShardStats()
+    {
+        CreateEventListener(nullptr, "Registry.Shards", [](SEvent) {});
+        const std::size_t shard = (std::size_t)LookupEventName("Registry.Shards") % EVENTLISTENER_SHARDS;
+        std::array<SShardStats, EVENTLISTENER_SHARDS> before = GetShardStats();
+        for (int i = 0; i < 10; ++i)
+            PushEvent("Registry.Shards");
+        std::array<SShardStats, EVENTLISTENER_SHARDS> after = GetShardStats();
+#ifdef EVENTLISTENER_COPY_ON_WRITE
+        // Pushes read the published table without locking.
+        CHECK_EQ(after[shard].acquisitions, before[shard].acquisitions);
+#else
+        CHECK_EQ(after[shard].acquisitions, before[shard].acquisitions + 10);
+#endif
+        CHECK_EQ(after[shard].contentions, before[shard].contentions);
+
+        // A registration that finds the shard's lock held counts as contended.
+        std::thread registrar;
+        {
+            const std::lock_guard<std::mutex> lock(EventListener::g_shards[shard].mutex);
+            registrar = std::thread([] { CreateEventListener(nullptr, "Registry.Shards", [](SEvent) {}); });
+            while (GetShardStats()[shard].contentions == after[shard].contentions)
+                std::this_thread::yield();
+        }
+        registrar.join();
+        std::array<SShardStats, EVENTLISTENER_SHARDS> contended = GetShardStats();
+        CHECK_EQ(contended[shard].contentions, after[shard].contentions + 1);
+        CHECK(contended[shard].acquisitions > after[shard].acquisitions);
+        for (std::size_t i = 0; i < EVENTLISTENER_SHARDS; ++i)
+            CHECK(contended[i].contentions <= contended[i].acquisitions);
+        CHECK_EQ(DeleteEventListeners("Registry.Shards"), 2);
+    }
+}
+
+int main()
+{
+    TestPushAndFilter();
+    TestEventFunctionPointer();
+    TestSEventFields();
+    TestPriorities();
+    TestStaleIds();
+    TestIdsNotReissuedSoon();
+    TestSubscription();
+    TestCompaction();
+    TestManyListeners();
+    TestBatchDelete();
+    TestConcurrentChurn();
+    TestDeleteDuringPush();
+    TestChurnWhileDispatching();
+    TestEventNames();
+    TestHashCollisions();
+    TestConcurrentNames();
+    TestPushEventBatch();
+    TestExceptionsAndStats();
+    TestSampling();
+    TestPercentiles();
+    TestShardStats();
+    return Report("registry");
+}
@@ -0,0 +1,11 @@
+/*
+ * Stand-in for systemtap's <sys/sdt.h>, used to build the EVENTLISTENER_USDT=1 test where the real header is not
+ * installed. Each probe is one nop with its arguments as "nor" asm operands, as in the real header, so every probe
+ * site is still compiled and its arguments type-checked.
+ */
+
+#pragma once
+
+#define DTRACE_PROBE2(p, n, a, b) __asm__ __volatile__("nop # " #p ":" #n " %0 %1" :: "nor"(a), "nor"(b))
+#define DTRACE_PROBE3(p, n, a, b, c) __asm__ __volatile__("nop # " #p ":" #n " %0 %1 %2" :: "nor"(a), "nor"(b), "nor"(c))
+#define DTRACE_PROBE4(p, n, a, b, c, d) __asm__ __volatile__("nop # " #p ":" #n " %0 %1 %2 %3" :: "nor"(a), "nor"(b), "nor"(c), "nor"(d))